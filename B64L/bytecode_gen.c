@@ -2,6 +2,7 @@
 // init lexing here instead of in main.c?
 #include "lex.h"
 #include "VM.h"
+#include "../arena8/arena8.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -12,6 +13,8 @@
                                          tk.line, tk.column, __VA_ARGS__)
 // buffer tb for multiple tks? incase of backtracking, etc
 static struct Tk tk;
+// Only emitted code goes here, tokens are owned by the lexer's arena
+static struct Arena *p_code_arena;
 
 
 uint8_t *gen_from_ident(struct Tk *p_tk, bool allow_standalone)
@@ -157,7 +160,7 @@ decl(enum TkType value_type)
         }
 
         // '4' for int, just testing int rn
-        code = malloc(1 + 4); // expr_size
+        code = arena_alloc(p_code_arena, 1 + 4); // expr_size
         // push_decl()
         code[0] = PUSH; // handle op modes e.g. 'USE_REG'
         memcpy(&code[1], &tk.value.int_v, 4);
@@ -169,8 +172,9 @@ decl(enum TkType value_type)
 }
 
 uint8_t *
-bytecode_gen_nofile(void)
+bytecode_gen_nofile(struct Arena *p_arena)
 {
+        p_code_arena = p_arena;
         // 'main.c' initialized lexer, maybe change that cuz a lil confusing
         do {
                 // let gen do it instead
@@ -206,7 +210,7 @@ bytecode_gen_nofile(void)
 }
 
 FILE *
-bytecode_gen_file(void)
+bytecode_gen_file(struct Arena *p_arena)
 {
-        
+        p_code_arena = p_arena;
 }
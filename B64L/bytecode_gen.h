@@ -1,6 +1,9 @@
 #include <stdint.h>
 #include <stdio.h>
 
-FILE *bytecode_gen_file(void);
-uint8_t *bytecode_gen_nofile(void);
+struct Arena;
+
+// Emitted bytecode is allocated from 'p_code_arena', which the caller frees once it's been run or written
+FILE *bytecode_gen_file(struct Arena *p_code_arena);
+uint8_t *bytecode_gen_nofile(struct Arena *p_code_arena);
 
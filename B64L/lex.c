@@ -14,9 +14,10 @@ n  - Don't lex integer or number using '-' symbol, treat '-' as an operator (una
   - Fix
 */
 
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS & madvise
 /*
-  Has types: 'struct Tk', 'TkType', 'TkTypeGroup'
-  Has defs: 'lex_init' & 'lex_next'
+  Has types: 'struct Tk', 'struct Lexer', 'TkType', 'TkTypeGroup'
+  Has defs: 'lexer_init', 'lexer_next' & the 'lex_' wrappers
 */
 #include "lex.h"
 #include "util.h"
@@ -25,21 +26,35 @@ n  - Don't lex integer or number using '-' symbol, treat '-' as an operator (una
   Has defs: 'hashmap_init', 'hashmap_free', 'hashmap_put.." bla blabla
 */
 #include "hashmap.h"
+/*
+  Has types: 'struct Arena', 'struct StrBuild'
+  Has defs: 'arena_init', 'strbuild_push', 'strbuild_finish'...
+*/
+#include "../arena8/strbuild.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdint.h>
 #include <errno.h>
+#include <float.h>
+#include <math.h>
 #include <stdbool.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+#if defined(__GNUC__) && defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define TAB_WIDTH 8       // Assumption, despite ambiguity 
-
-static long src_line = 1;
-static long src_column = 0;
-static long src_i = 0;
-static long src_len;
-static char *src_txt;
+#define STREAM_CHUNK_SIZE (64 * 1024) // bytes read at once when streaming, the window grows past it for long lines
+#define LEX_PARALLEL_MIN_CHUNK (256 * 1024) // less isn't worth a thread
+#define SRC_WORKER_ARENA_SIZE (64 * 1024)
 
 static const char* keywords[] = {
         "bool", "char", "int", "num",
@@ -50,37 +65,245 @@ static const char* keywords[] = {
         "fn"
 };
 
-static struct HashMap keywords_hashmap;
+// Backs the 'lex_init', 'lex_next' & 'lex_free' wrappers
+static struct Lexer default_lexer;
 
 // NOTE: Might have to change later if wanting variadic args
-#define WARN(msg) printf("WARNING (L%ld C%ld): " msg "\n", src_line, src_column)
-#define WARN_FMT(msg, ...) printf("WARNING (L%ld C%ld): " msg "\n", src_line, src_column, __VA_ARGS__)
-#define LEX_ERR(msg) (fprintf(stderr, "ERROR (L%ld C%ld): " msg "\n", src_line, src_column), exit(EXIT_FAILURE))
-#define LEX_ERR_FMT(msg, ...) (fprintf(stderr, "ERROR (L%ld C%ld): " msg "\n", src_line, src_column, __VA_ARGS__), exit(EXIT_FAILURE))
+#define WARN(msg) printf("WARNING (L%ld C%ld): " msg "\n", p_lex->src_line, p_lex->src_column)
+#define WARN_FMT(msg, ...) printf("WARNING (L%ld C%ld): " msg "\n", p_lex->src_line, p_lex->src_column, __VA_ARGS__)
+// A speculative lexer (see 'lex_all_parallel') jumps out instead
+#define LEX_ERR(msg) (p_lex->p_err_jmp != NULL ? longjmp(*p_lex->p_err_jmp, 1) : (void) 0, \
+                      fprintf(stderr, "ERROR (L%ld C%ld): " msg "\n", p_lex->src_line, p_lex->src_column), exit(EXIT_FAILURE))
+#define LEX_ERR_FMT(msg, ...) (p_lex->p_err_jmp != NULL ? longjmp(*p_lex->p_err_jmp, 1) : (void) 0, \
+                               fprintf(stderr, "ERROR (L%ld C%ld): " msg "\n", p_lex->src_line, p_lex->src_column, __VA_ARGS__), exit(EXIT_FAILURE))
 
 // NOTE: May remove macros and use a variable to just set both of these once per token lexed
-#define INCPOS() (src_i++, src_column++)
-#define DECPOS() (src_i--, src_column--)
+#define INCPOS() (p_lex->src_i++, p_lex->src_column++)
+#define DECPOS() (p_lex->src_i--, p_lex->src_column--)
 // left operand is guaranteed evaluation *1st*
-#define SET_POS(pos) (src_column += (pos - src_i), src_i = pos)
-#define GET_C() src_txt[src_i]
-#define NEXT_C() src_txt[src_i + 1]
-#define PREV_C() src_txt[src_i - 1]
+#define SET_POS(pos) (p_lex->src_column += (pos - p_lex->src_i), p_lex->src_i = pos)
+#define GET_C() p_lex->src_txt[p_lex->src_i]
+#define NEXT_C() p_lex->src_txt[p_lex->src_i + 1]
+#define PREV_C() p_lex->src_txt[p_lex->src_i - 1]
+
+/*
+  Lookup tables instead of <ctype.h> (locale aware calls) & a switch per character,
+  'char_class' for scanning, 'tk_start' for what a token starting with a char is,
+  'single_tks' & 'op_table' for the tokens themselves
+*/
+#define CC_SPACE  0x01
+#define CC_DIGIT  0x02
+#define CC_XDIGIT 0x04
+#define CC_IDENT  0x08  // letters, digits & '_'
+#define CC_LIT    0x10  // allowed as is in char & string literals, printable or whitespace
+
+#define SP (CC_SPACE | CC_LIT)
+#define DG (CC_DIGIT | CC_XDIGIT | CC_IDENT | CC_LIT)
+#define XL (CC_XDIGIT | CC_IDENT | CC_LIT)
+#define ID (CC_IDENT | CC_LIT)
+#define PU CC_LIT
+static const uint8_t char_class[256] = {
+         0,  0,  0,  0,  0,  0,  0,  0,  0, SP, SP, SP, SP, SP,  0,  0, // 0x00
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0x10
+        SP, PU, PU, PU, PU, PU, PU, PU, PU, PU, PU, PU, PU, PU, PU, PU, // 0x20
+        DG, DG, DG, DG, DG, DG, DG, DG, DG, DG, PU, PU, PU, PU, PU, PU, // 0x30
+        PU, XL, XL, XL, XL, XL, XL, ID, ID, ID, ID, ID, ID, ID, ID, ID, // 0x40
+        ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, PU, PU, PU, PU, ID, // 0x50
+        PU, XL, XL, XL, XL, XL, XL, ID, ID, ID, ID, ID, ID, ID, ID, ID, // 0x60
+        ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, ID, PU, PU, PU, PU,  0, // 0x70
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0x80
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0x90
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0xa0
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0xb0
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0xc0
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0xd0
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0xe0
+         0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, // 0xf0
+};
+#undef SP
+#undef DG
+#undef XL
+#undef ID
+#undef PU
+
+#define CHAR_CLASS(c) char_class[(unsigned char) (c)]
+#define IS_SPACE(c) (CHAR_CLASS(c) & CC_SPACE)
+#define IS_DIGIT(c) (CHAR_CLASS(c) & CC_DIGIT)
+#define IS_XDIGIT(c) (CHAR_CLASS(c) & CC_XDIGIT)
+#define IS_IDENT(c) (CHAR_CLASS(c) & CC_IDENT)
+#define IS_LIT(c) (CHAR_CLASS(c) & CC_LIT)
+
+enum TkStart {
+        TS_BAD,
+        TS_END,
+        TS_SINGLE,      // 'single_tks'
+        TS_OP,          // 'op_table'
+        TS_IDENT,
+        TS_ZERO,        // maybe a '0x' or '0b' prefix
+        TS_DIGIT,
+        TS_PERIOD,
+        TS_CHAR,
+        TS_STR
+};
+
+#define BAD TS_BAD
+#define NUL TS_END
+#define SGL TS_SINGLE
+#define OP TS_OP
+#define ID TS_IDENT
+#define ZR TS_ZERO
+#define DG TS_DIGIT
+#define PRD TS_PERIOD
+#define CHR TS_CHAR
+#define STR TS_STR
+static const uint8_t tk_start[256] = {
+        NUL, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0x00
+        BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0x10
+        BAD,  OP, STR, BAD, BAD,  OP,  OP, CHR, SGL, SGL,  OP,  OP, BAD,  OP, PRD,  OP, // 0x20
+         ZR,  DG,  DG,  DG,  DG,  DG,  DG,  DG,  DG,  DG, SGL, SGL,  OP,  OP,  OP, SGL, // 0x30
+        BAD,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID, // 0x40
+         ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID, SGL, BAD, SGL,  OP,  ID, // 0x50
+        BAD,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID, // 0x60
+         ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID,  ID, SGL,  OP, SGL, BAD, BAD, // 0x70
+        BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0x80
+        BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0x90
+        BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0xa0
+        BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0xb0
+        BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0xc0
+        BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0xd0
+        BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0xe0
+        BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, // 0xf0
+};
+#undef BAD
+#undef NUL
+#undef SGL
+#undef OP
+#undef ID
+#undef ZR
+#undef DG
+#undef PRD
+#undef CHR
+#undef STR
 
-static inline void handle_tab_char(void)
+// All 'G_MISC'
+static const uint8_t single_tks[256] = {
+        ['('] = PAREN_L, [')'] = PAREN_R,
+        ['['] = BRACKET_L, [']'] = BRACKET_R,
+        ['{'] = BRACE_L, ['}'] = BRACE_R,
+        ['?'] = QUESTION, [':'] = COLON, [';'] = SEMICOLON
+};
+
+// Forms of an operator by its first char, e.g. '<', '<=', '<<', '<<='
+enum OpForm {
+        OP_FORM_ALONE,
+        OP_FORM_ALONE_AS,       // followed by '='
+        OP_FORM_DOUBLED,
+        OP_FORM_DOUBLED_AS
+};
+
+#define NO_OP UINT8_MAX
+struct OpForms {
+        uint8_t type[4];        // 'NO_OP' if there's no such form
+        uint8_t group[4];
+};
+
+static const struct OpForms op_table[256] = {
+        ['='] = {{OP_AS, OP_EQ, NO_OP, NO_OP}, {G_OP_ASSIGN, G_OP_LOGICAL}},
+        ['+'] = {{OP_ADD, OP_ADD_AS, OP_INC, NO_OP}, {G_OP_ARITH, G_OP_ASSIGN, G_OP_ARITH}},
+        ['-'] = {{OP_SUB, OP_SUB_AS, OP_DEC, NO_OP}, {G_OP_ARITH, G_OP_ASSIGN, G_OP_ARITH}},
+        ['*'] = {{OP_MUL, OP_MUL_AS, NO_OP, NO_OP}, {G_OP_ARITH, G_OP_ASSIGN}},
+        ['/'] = {{OP_DIV, OP_DIV_AS, NO_OP, NO_OP}, {G_OP_ARITH, G_OP_ASSIGN}},
+        ['%'] = {{OP_MOD, OP_MOD_AS, NO_OP, NO_OP}, {G_OP_ARITH, G_OP_ASSIGN}},
+        ['!'] = {{OP_NOT, OP_NOT_EQ, NO_OP, NO_OP}, {G_OP_LOGICAL, G_OP_LOGICAL}},
+        // '^' is pow, '^^' is xor
+        ['^'] = {{OP_POW, OP_POW_AS, OP_BXOR, OP_BXOR_AS}, {G_OP_ARITH, G_OP_ASSIGN, G_OP_BITWISE, G_OP_ASSIGN}},
+        ['&'] = {{OP_BAND, OP_BAND_AS, OP_AND, NO_OP}, {G_OP_BITWISE, G_OP_ASSIGN, G_OP_LOGICAL}},
+        ['|'] = {{OP_BOR, OP_BOR_AS, OP_OR, NO_OP}, {G_OP_BITWISE, G_OP_ASSIGN, G_OP_LOGICAL}},
+        ['<'] = {{OP_LESS, OP_LESS_OR_EQ, OP_BSHL, OP_BSHL_AS}, {G_OP_LOGICAL, G_OP_LOGICAL, G_OP_BITWISE, G_OP_ASSIGN}},
+        ['>'] = {{OP_GREATER, OP_GREATER_OR_EQ, OP_BSHR, OP_BSHR_AS}, {G_OP_LOGICAL, G_OP_LOGICAL, G_OP_BITWISE, G_OP_ASSIGN}}
+};
+
+// Once per file, not per tab
+static inline void warn_tab_width(struct Lexer *p_lex)
 {
+        if (p_lex->warned_tab_width)
+                return;
+        p_lex->warned_tab_width = true;
         WARN_FMT("Tab character '\\t' width assumed to be %d spaces despite ambigious "
                  "width and interpration, may lead to inaccurate lexing column numbers",
                  TAB_WIDTH);
-        src_i++;
-        src_column += TAB_WIDTH;
 }
 
-static inline void handle_newline_char(void)
+static inline void handle_tab_char(struct Lexer *p_lex)
+{
+        warn_tab_width(p_lex);
+        p_lex->src_i++;
+        p_lex->src_column += TAB_WIDTH;
+}
+
+static inline void handle_newline_char(struct Lexer *p_lex)
+{
+        p_lex->src_i++;
+        p_lex->src_line++;
+        p_lex->src_column = 0;
+}
+
+/*
+  Streaming keeps a window of the source instead of all of it, no token spans a line
+  so the window is refilled whenever the line at 'src_i' isn't whole yet
+  Everything before 'src_i' is dropped on a refill, which is fine since
+  identifiers & string literals are copied into the arena instead of being slices
+*/
+static bool stream_fill_line(struct Lexer *p_lex)
 {
-        src_i++;
-        src_line++;
-        src_column = 0;
+        if (p_lex->src_stream == NULL || p_lex->src_eof || p_lex->src_i <= p_lex->src_last_nl)
+                return false;
+        // no '\n' in what's kept, otherwise the line would've been whole
+        long keep = p_lex->src_len - p_lex->src_i;
+        memmove(p_lex->src_buf, p_lex->src_buf + p_lex->src_i, (size_t) keep);
+        p_lex->src_i = 0;
+        p_lex->src_len = keep;
+        p_lex->src_last_nl = -1;
+        long start_len = keep;
+        do {
+                // +1 for the '\0' sentinel
+                if (p_lex->src_cap - p_lex->src_len < STREAM_CHUNK_SIZE + 1) {
+                        long cap = p_lex->src_cap * 2;
+                        char *txt = realloc(p_lex->src_buf, (size_t) cap);
+                        if (txt == NULL)
+                                LEX_ERR("Failed memory alloc for source window");
+                        p_lex->src_txt = p_lex->src_buf = txt;
+                        p_lex->src_cap = cap;
+                }
+                char *chunk = p_lex->src_buf + p_lex->src_len;
+                size_t n = fread(chunk, 1, STREAM_CHUNK_SIZE, p_lex->src_stream);
+                if (n < STREAM_CHUNK_SIZE) {
+                        if (ferror(p_lex->src_stream))
+                                PERREXIT("Failed to read source file");
+                        p_lex->src_eof = true;
+                }
+                // counted down in size_t, 'n' may be 0
+                for (size_t i = n; i-- > 0; )
+                        if (chunk[i] == '\n') {
+                                p_lex->src_last_nl = p_lex->src_len + (long) i;
+                                break;
+                        }
+                p_lex->src_len += (long) n;
+        } while (!p_lex->src_eof && p_lex->src_last_nl == -1);
+        p_lex->src_buf[p_lex->src_len] = '\0';
+        return p_lex->src_len != start_len;
+}
+
+// Slices of the source only live until the next refill when streaming, so those are copied
+static const char *keep_src_txt(struct Lexer *p_lex, const char *txt, long len)
+{
+        if (p_lex->src_stream == NULL || len == 0)
+                return txt;
+        char *copy = arena_alloc(p_lex->p_arena, (size_t) len);
+        if (copy == NULL)
+                LEX_ERR("Failed memory alloc for token text");
+        memcpy(copy, txt, (size_t) len);
+        return copy;
 }
 
 // IF invalid char for escape sequence, -1 is returned
@@ -97,164 +320,467 @@ static inline int esc_seq_from_char(char c)
         }
 }
 
-// support octal integers?
-static void lex_bin_int(struct Tk *p_tk)
+#if defined(__GNUC__) && (defined(__AVX2__) || defined(__SSE2__))
+/*
+  Bulk skipping for whitespace, comments & string literals, a block of bytes is compared at once
+  and line & column are fixed up from the newline & tab masks of the skipped bytes,
+  the scalar loops after it handle the byte it stopped at & the last few bytes of the source
+*/
+#ifdef __AVX2__
+#define SIMD_WIDTH 32
+typedef __m256i SimdVec;
+static inline SimdVec simd_load(const char *p) { return _mm256_loadu_si256((const __m256i*) p); }
+static inline uint32_t simd_eq(SimdVec v, char c)
 {
-        p_tk->type_group = G_LITERAL;
-        p_tk->type = LIT_INT;
-        p_tk->value.int_v = 0;
-        char c = GET_C();;
-        // never write this again please
-        for (int i = 0; i < 64; i++, (INCPOS(), c = GET_C())) {
-                if (c == '0' || c == '1') {
-                        p_tk->value.int_v <<= 1 | (c - '0');
+        return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+// bytes <= 'hi' once 'lo' is subtracted, unsigned compare through min
+static inline uint32_t simd_in_range(SimdVec v, char lo, char hi)
+{
+        __m256i off = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+        __m256i limit = _mm256_set1_epi8((char) (hi - lo));
+        return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(off, limit), off));
+}
+#else
+#define SIMD_WIDTH 16
+typedef __m128i SimdVec;
+static inline SimdVec simd_load(const char *p) { return _mm_loadu_si128((const __m128i*) p); }
+static inline uint32_t simd_eq(SimdVec v, char c)
+{
+        return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+static inline uint32_t simd_in_range(SimdVec v, char lo, char hi)
+{
+        __m128i off = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+        __m128i limit = _mm_set1_epi8((char) (hi - lo));
+        return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(off, limit), off));
+}
+#endif
+#define SIMD_ALL ((uint32_t) (((uint64_t) 1 << SIMD_WIDTH) - 1))
+
+enum SkipKind {
+        SKIP_SPACE,
+        SKIP_LINE_COMMENT,      // up to the '\n' or '\0'
+        SKIP_BLOCK_COMMENT,     // up to the '*/' or '\0'
+        SKIP_STR                // printable bytes other than '"' & '\\'
+};
+
+// Advance over 'len' bytes, 'newlines' & 'tabs' are masks of them
+static inline void advance_bytes(struct Lexer *p_lex, uint32_t newlines, uint32_t tabs, int len)
+{
+        if (newlines != 0) {
+                int last_newline = 31 - __builtin_clz(newlines);
+                p_lex->src_line += __builtin_popcount(newlines);
+                tabs &= ~(uint32_t) (((uint64_t) 2 << last_newline) - 1);
+                p_lex->src_column = len - last_newline - 1;
+        } else
+                p_lex->src_column += len;
+        p_lex->src_column += (long) __builtin_popcount(tabs) * (TAB_WIDTH - 1);
+        p_lex->src_i += len;
+}
+
+// Same as 'advance_bytes', but the tab width warning is at the first tab like the scalar loops
+static inline void skip_bytes(struct Lexer *p_lex, uint32_t newlines, uint32_t tabs, int len)
+{
+        if (tabs != 0 && !p_lex->warned_tab_width) {
+                int first_tab = __builtin_ctz(tabs);
+                advance_bytes(p_lex, newlines & (((uint32_t) 1 << first_tab) - 1), 0, first_tab);
+                warn_tab_width(p_lex);
+                newlines >>= first_tab;
+                tabs >>= first_tab;
+                len -= first_tab;
+        }
+        advance_bytes(p_lex, newlines, tabs, len);
+}
+
+static void simd_skip(struct Lexer *p_lex, enum SkipKind kind)
+{
+        // block comments read one byte ahead for the '/'
+        long lookahead = kind == SKIP_BLOCK_COMMENT;
+        while (p_lex->src_i + SIMD_WIDTH + lookahead <= p_lex->src_len) {
+                const char *p = p_lex->src_txt + p_lex->src_i;
+                SimdVec v = simd_load(p);
+                uint32_t newlines = simd_eq(v, '\n');
+                uint32_t tabs = simd_eq(v, '\t');
+                uint32_t stop;
+                switch (kind) {
+                case SKIP_SPACE:
+                        // '\t' '\n' '\v' '\f' '\r' are contiguous
+                        stop = ~(simd_eq(v, ' ') | simd_in_range(v, '\t', '\r')) & SIMD_ALL;
+                        break;
+                case SKIP_LINE_COMMENT:
+                        stop = newlines | simd_eq(v, '\0');
+                        break;
+                case SKIP_STR:
+                        // the closing '"', escapes, control chars & anything past ascii stop it
+                        stop = ~(simd_in_range(v, ' ', '~') & ~(simd_eq(v, '"') | simd_eq(v, '\\'))) & SIMD_ALL;
+                        break;
+                case SKIP_BLOCK_COMMENT:
+                default:
+                        stop = (simd_eq(v, '*') & simd_eq(simd_load(p + 1), '/')) | simd_eq(v, '\0');
+                }
+                if (stop == 0) {
+                        skip_bytes(p_lex, newlines, tabs, SIMD_WIDTH);
                         continue;
                 }
-
-                if (isdigit(c))
-                        LEX_ERR_FMT("Expected binary digits after binary"
-                                    " integer literal prefix '0b',"
-                                    " instead got decimal digit '%c'", c);
-                else if (isxdigit(c))
-                        LEX_ERR_FMT("Expected binary digits after binary"
-                                    " integer literal prefix '0b',"
-                                    " instead got hexadecimal digit '%c'", c);
-                // non-digit character case
-                break;
+                int len = __builtin_ctz(stop);
+                uint32_t before = (uint32_t) (((uint64_t) 1 << len) - 1);
+                skip_bytes(p_lex, newlines & before, tabs & before, len);
+                return;
         }
+}
+#else
+enum SkipKind {
+        SKIP_SPACE,
+        SKIP_LINE_COMMENT,
+        SKIP_BLOCK_COMMENT,
+        SKIP_STR
+};
+
+// No SIMD, the scalar loops do all of it
+static inline void simd_skip(struct Lexer *p_lex, enum SkipKind kind)
+{
+        (void) p_lex, (void) kind;
+}
+#endif
+
+/*
+  Integer literals are converted 8 digits at a time within a 64-bit word (SWAR),
+  the digits are counted first so overflow is just the digit count & one compare
+  Needs a little-endian load so the first digit is the lowest byte, otherwise it's all scalar
+*/
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SWAR_DIGITS
+#endif
+
+static inline uint64_t load_8_bytes(const char *p)
+{
+        uint64_t v;
+        memcpy(&v, p, sizeof v);
+        return v;
+}
 
-        printf("%ld %c\n", src_column, c);
-        if (c == '0' || c == '1')
+// Same checks & multiplies as simdjson
+static inline bool swar_is_8_digits(uint64_t v)
+{
+        return ((v & 0xF0F0F0F0F0F0F0F0) |
+                (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+}
+
+static inline uint32_t swar_8_digits(uint64_t v)
+{
+        v = ((v & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+        v = ((v & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+        return (uint32_t) (((v & 0x0000FFFF0000FFFF) * 42949672960001) >> 32);
+}
+
+// '0'-'9', 'a'-'f' & 'A'-'F' to 0-15, letters are the ones with bit 6 set
+#define XDIGIT_VALUE(c) (((c) & 0xF) + 9 * (((c) >> 6) & 1))
+
+static inline uint32_t swar_8_xdigits(uint64_t v)
+{
+        v = (v & 0x0F0F0F0F0F0F0F0F) + 9 * ((v >> 6) & 0x0101010101010101);
+        // first digit to the top byte, then pack nibble pairs, byte pairs & halves
+        v = __builtin_bswap64(v);
+        v = (v | (v >> 4)) & 0x00FF00FF00FF00FF;
+        v = (v | (v >> 8)) & 0x0000FFFF0000FFFF;
+        return (uint32_t) (v | (v >> 16));
+}
+
+// Each byte's low bit lands on its own bit of the top byte, first digit highest
+static inline uint32_t swar_8_bdigits(uint64_t v)
+{
+        return (uint32_t) (((v & 0x0101010101010101) * 0x8040201008040201) >> 56);
+}
+
+static long count_dec_digits(struct Lexer *p_lex, const char *p)
+{
+        long n = 0;
+#ifdef SWAR_DIGITS
+        while (p + n + 8 <= p_lex->src_txt + p_lex->src_len && swar_is_8_digits(load_8_bytes(p + n)))
+                n += 8;
+#endif
+        while (IS_DIGIT(p[n]))
+                n++;
+        return n;
+}
+
+static inline long count_leading_zeros(const char *p, long len)
+{
+        long n = 0;
+        while (n < len && p[n] == '0')
+                n++;
+        return n;
+}
+
+// support octal integers?
+static void lex_bin_int(struct Lexer *p_lex, struct Tk *p_tk)
+{
+        p_tk->type_group = G_LITERAL;
+        p_tk->type = LIT_INT;
+        const char *p = p_lex->src_txt + p_lex->src_i;
+        long len = 0;
+        while (p[len] == '0' || p[len] == '1')
+                len++;
+        long zeros = count_leading_zeros(p, len);
+        if (len - zeros > 64) {
+                SET_POS(p_lex->src_i + zeros + 64);
                 LEX_ERR("Binary integer literal exceeds 64 digits, above 64-bit range");
-        if (isdigit(c))
-                LEX_ERR_FMT("Binary integer literal exceeds 64 digits,"
-                        " above 64-bit range AND got decimal digit '%c'", c);
-        else if (isxdigit(c))
-                LEX_ERR_FMT("Binary integer literal exceeds 64 digits,"
-                            " above 64-bit range AND got hexadecimal"
-                            " digit '%c'", c);
+        }
+        char c = p[len];
+        if (IS_DIGIT(c)) {
+                SET_POS(p_lex->src_i + len);
+                LEX_ERR_FMT("Expected binary digits after binary"
+                            " integer literal prefix '0b',"
+                            " instead got decimal digit '%c'", c);
+        }
+        else if (IS_XDIGIT(c)) {
+                SET_POS(p_lex->src_i + len);
+                LEX_ERR_FMT("Expected binary digits after binary"
+                            " integer literal prefix '0b',"
+                            " instead got hexadecimal digit '%c'", c);
+        }
+
+        uint64_t value = 0;
+        long i = zeros;
+#ifdef SWAR_DIGITS
+        for (; len - i >= 8; i += 8)
+                value = value << 8 | swar_8_bdigits(load_8_bytes(p + i));
+#endif
+        for (; i < len; i++)
+                value = value << 1 | (uint64_t) (p[i] - '0');
+        // all 64 bits are the literal's, so the top one ends up as the sign
+        p_tk->value.int_v = (int64_t) value;
+        SET_POS(p_lex->src_i + len);
 }
 
-static void lex_hex_int(struct Tk *p_tk)
+static void lex_hex_int(struct Lexer *p_lex, struct Tk *p_tk)
 {
         p_tk->type_group = G_LITERAL;
         p_tk->type = LIT_INT;
-        p_tk->value.int_v = 0;
-        char c;
-        for (int i = 0; i < 8; i++) {
-                switch (c = GET_C()) {
-                case 'a': case 'A': p_tk->value.int_v <<= 4 | 10; break;
-                case 'b': case 'B': p_tk->value.int_v <<= 4 | 11; break;
-                case 'c': case 'C': p_tk->value.int_v <<= 4 | 12; break;
-                case 'd': case 'D': p_tk->value.int_v <<= 4 | 13; break;
-                case 'e': case 'E': p_tk->value.int_v <<= 4 | 14; break;
-                case 'f': case 'F': p_tk->value.int_v <<= 4 | 15; break;
-                default:
-                        if (!isdigit(c))
-                                return;
-                        p_tk->value.int_v <<= 4 | (c - '0');
+        const char *p = p_lex->src_txt + p_lex->src_i;
+        long len = 0;
+        while (IS_XDIGIT(p[len]))
+                len++;
+        long zeros = count_leading_zeros(p, len);
+        if (len - zeros > 16) {
+                SET_POS(p_lex->src_i + zeros + 16);
+                LEX_ERR("Hexadecimal integer literal exceeds 16 digits, above 64-bit range");
+        }
+
+        uint64_t value = 0;
+        long i = zeros;
+#ifdef SWAR_DIGITS
+        for (; len - i >= 8; i += 8)
+                value = value << 32 | swar_8_xdigits(load_8_bytes(p + i));
+#endif
+        for (; i < len; i++)
+                value = value << 4 | (uint64_t) XDIGIT_VALUE(p[i]);
+        p_tk->value.int_v = (int64_t) value;
+        SET_POS(p_lex->src_i + len);
+}
+
+// A decimal float literal split up, 'mantissa' * 10^'exp10'
+struct NumParts {
+        uint64_t mantissa;      // first 19 significant digits
+        long exp10;
+        bool truncated;         // non-zero digits past the first 19
+        bool has_point;
+        long len;               // bytes of the literal, without the 'f' suffix
+};
+
+#define NUM_MAX_DIGITS 19       // always fits a 'uint64_t'
+#define NUM_MAX_EXP10 100000    // way past what a 'double' can hold, stops the exponent overflowing
+
+// digits ['.' digits] [('e' | 'E') ['+' | '-'] digits], only reads the literal itself
+static void scan_num(const char *p, struct NumParts *p_parts)
+{
+        uint64_t mantissa = 0;
+        int digits = 0;
+        long exp10 = 0;
+        bool truncated = false;
+        long i = 0;
+        for (; IS_DIGIT(p[i]); i++) {
+                if (digits < NUM_MAX_DIGITS) {
+                        mantissa = mantissa * 10 + (uint64_t) (p[i] - '0');
+                        // leading zeros aren't significant
+                        digits += mantissa != 0;
+                } else {
+                        exp10++;
+                        truncated |= p[i] != '0';
+                }
+        }
+        p_parts->has_point = p[i] == '.';
+        if (p_parts->has_point) {
+                for (i++; IS_DIGIT(p[i]); i++) {
+                        if (digits < NUM_MAX_DIGITS) {
+                                mantissa = mantissa * 10 + (uint64_t) (p[i] - '0');
+                                digits += mantissa != 0;
+                                exp10--;
+                        } else
+                                truncated |= p[i] != '0';
                 }
-                INCPOS();
         }
-        if (isxdigit(GET_C()))
-                LEX_ERR("Hexadecimal integer literal exceeds 8 digits, above 64-bit range");
+        // an 'e' without digits after it isn't part of the literal
+        if (p[i] == 'e' || p[i] == 'E') {
+                long exp_i = i + 1 + (p[i + 1] == '+' || p[i + 1] == '-');
+                if (IS_DIGIT(p[exp_i])) {
+                        long exp = 0;
+                        for (i = exp_i; IS_DIGIT(p[i]); i++)
+                                if (exp < NUM_MAX_EXP10)
+                                        exp = exp * 10 + (p[i] - '0');
+                        exp10 += p[exp_i - 1] == '-' ? -exp : exp;
+                }
+        }
+        p_parts->mantissa = mantissa;
+        p_parts->exp10 = exp10;
+        p_parts->truncated = truncated;
+        p_parts->len = i;
 }
 
 /*
-  IF 'non-fractional_int' is true (1000% sure there is no *decimal point*,
-  resulting from attempting to lex an int that would've *overflowed*)
+  Clinger's fast path, exact since both the mantissa & the power of 10 are exact doubles
+  and IEEE multiplication & division round once, false if it doesn't apply
+  NOTE: needs 'FLT_EVAL_METHOD' 0, x87 would round twice
+*/
+static bool num_fast_path(const struct NumParts *p_parts, double *p_value)
+{
+#if FLT_EVAL_METHOD == 0
+        static const double pow10_exact[] = {
+                1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        if (p_parts->truncated || p_parts->mantissa > (uint64_t) 1 << 53 ||
+            p_parts->exp10 < -22 || p_parts->exp10 > 22)
+                return false;
+        double value = (double) p_parts->mantissa;
+        if (p_parts->exp10 < 0)
+                value /= pow10_exact[-p_parts->exp10];
+        else
+                value *= pow10_exact[p_parts->exp10];
+        *p_value = value;
+        return true;
+#else
+        (void) p_parts, (void) p_value;
+        return false;
+#endif
+}
+
+// 'strtod' on a NUL-terminated copy of just the literal, for what the fast path can't round exactly
+// B64L never calls 'setlocale', so the decimal point is always '.'
+static double num_slow_path(struct Lexer *p_lex, const char *p, long len)
+{
+        char small_buf[64];
+        char *buf = small_buf;
+        if (len >= (long) sizeof small_buf &&
+            (buf = arena_alloc(p_lex->p_arena, (size_t) len + 1)) == NULL)
+                LEX_ERR("Failed memory alloc for number literal");
+        memcpy(buf, p, (size_t) len);
+        buf[len] = '\0';
+        errno = 0;
+        double value = strtod(buf, NULL);
+        // underflow to a denormal or 0 is fine, only overflow is an error
+        if (errno == ERANGE && isinf(value))
+                LEX_ERR("floating-point number overflow");
+        return value;
+}
 
-  CHECK for *suffix* 'f', otherwise error, assuming an attempt at lexing a massive 'int'
+/*
+  Without a decimal point or suffix 'f' it was an 'int' too large for 64 bits
+  Self contained, the literal is scanned once & nothing past it is read
 */
-static void lex_num(struct Tk *p_tk)
+static void lex_num(struct Lexer *p_lex, struct Tk *p_tk)
 {
         p_tk->type_group = G_LITERAL;
         p_tk->type = LIT_NUM;
-        // IF success 'src_txt' is advanced beyond the lexed num
-        errno = 0;
-        char *num_src_txt_end;
-        p_tk->value.fp_v = strtod(src_txt + src_i, &num_src_txt_end);
-        bool no_decimal = strchr(src_txt + src_i, '.') == NULL;
+        struct NumParts parts;
+        scan_num(p_lex->src_txt + p_lex->src_i, &parts);
+        bool has_suffix = p_lex->src_txt[p_lex->src_i + parts.len] == 'f';
         // point to *last digit* instead incase of overflow debugging error messages
-        SET_POS((num_src_txt_end - src_txt) - 1);
-
-        if (*num_src_txt_end != 'f') {
-                // assume a very large 'int' was attempted to be lexed
-                if (no_decimal)
-                        LEX_ERR("64-bit integer literal overflow");
-        } else
+        long num_src_i = p_lex->src_i;
+        SET_POS(p_lex->src_i + parts.len - 1);
+        if (!parts.has_point && !has_suffix)
+                LEX_ERR("64-bit integer literal overflow");
+        if (!num_fast_path(&parts, &p_tk->value.fp_v))
+                p_tk->value.fp_v = num_slow_path(p_lex, p_lex->src_txt + num_src_i, parts.len);
+        if (has_suffix)
                 INCPOS();
-        if (errno == ERANGE)
-                LEX_ERR("floating-point number overflow");
         INCPOS();
 }
 
-// probably need a more robust integer lexer
-static void lex_dec_int_or_num(struct Tk *p_tk)
+// Falls back to 'lex_num' for fractions, the 'f' suffix & anything past INT64_MAX
+static void lex_dec_int_or_num(struct Lexer *p_lex, struct Tk *p_tk)
 {
         p_tk->type_group = G_LITERAL;
         p_tk->type = LIT_INT;
-        long int_src_i_start = src_i;
-        char c;
-        while (true) {
-                c = GET_C();
-                if (c == '.' || c == 'f')
-                        goto try_lex_num;
-                if (!isdigit(c))
-                        return;
-                if (p_tk->value.int_v > INT64_MAX / 10) { printf("asd\n");
-                        goto try_lex_num;}
-                // C standard guarantees decimal digits are in order
-                p_tk->value.int_v *= 10;
-                if (p_tk->value.int_v > INT64_MAX - (c - '0'))
-                        goto try_lex_num;
-                p_tk->value.int_v += (c - '0');
-                INCPOS();
+        const char *p = p_lex->src_txt + p_lex->src_i;
+        long len = count_dec_digits(p_lex, p);
+        if (p[len] == '.' || p[len] == 'f') {
+                lex_num(p_lex, p_tk);
+                return;
+        }
+        long zeros = count_leading_zeros(p, len);
+        // 19 digits is the most INT64_MAX has, fewer never overflow
+        if (len - zeros > 19) {
+                lex_num(p_lex, p_tk);
+                return;
         }
 
-try_lex_num:
-        p_tk->value.fp_v = 0;
-        // to allow rereading previous digit(s)
-        SET_POS(int_src_i_start);
-        lex_num(p_tk);
+        uint64_t value = 0;
+        long i = zeros;
+#ifdef SWAR_DIGITS
+        for (; len - i >= 8; i += 8)
+                value = value * 100000000 + swar_8_digits(load_8_bytes(p + i));
+#endif
+        for (; i < len; i++)
+                value = value * 10 + (uint64_t) (p[i] - '0');
+        if (value > INT64_MAX) {
+                lex_num(p_lex, p_tk);
+                return;
+        }
+        p_tk->value.int_v = (int64_t) value;
+        SET_POS(p_lex->src_i + len);
 }
 
-static void lex_op_other_or_assign(struct Tk *p_tk, enum TkTypeGroup op_type_group,
-                        enum TkType op_type, enum TkType assigner_type)
+// The first char is already read, takes the longest form 'op_table' has
+static void lex_op(struct Lexer *p_lex, struct Tk *p_tk, char c)
 {
-        if (GET_C() == '=') {
-                p_tk->type_group = G_OP_ASSIGN;
-                p_tk->type = assigner_type;
+        const struct OpForms *p_forms = &op_table[(unsigned char) c];
+        int form = OP_FORM_ALONE;
+        if (GET_C() == c && p_forms->type[OP_FORM_DOUBLED] != NO_OP) {
                 INCPOS();
-        } else {
-                p_tk->type_group = op_type_group;
-                p_tk->type = op_type;
+                form = OP_FORM_DOUBLED;
+        }
+        // '_AS' is always the form after
+        if (GET_C() == '=' && p_forms->type[form + 1] != NO_OP) {
+                INCPOS();
+                form++;
         }
+        p_tk->type_group = (enum TkTypeGroup) p_forms->group[form];
+        p_tk->type = (enum TkType) p_forms->type[form];
 }
 
 // temp to remove warnings
 // will finish
 // test this later
-static void lex_keyword_or_identifier(struct Tk *p_tk)
+static void lex_keyword_or_identifier(struct Lexer *p_lex, struct Tk *p_tk)
 {
-        char *txt_start = src_txt + src_i;
+        const char *txt_start = p_lex->src_txt + p_lex->src_i;
         char c = GET_C();
-        while (isalpha(c) || isdigit(c) || c == '_') {
+        while (IS_IDENT(c)) {
                 INCPOS();
                 c = GET_C();
         }
-        size_t len = (size_t) (src_column - p_tk->column);
-        int keyword_type_enum = hashmap_get_int(&keywords_hashmap,
+        size_t len = (size_t) (p_lex->src_txt + p_lex->src_i - txt_start);
+        int keyword_type_enum = hashmap_get_int(&p_lex->keywords_hashmap,
                                                 txt_start, len);
         // -1 means key *not found*
         if (keyword_type_enum == -1) {
                 p_tk->type_group = G_MISC;
                 p_tk->type = IDENTIFIER;
-                p_tk->value.txt = malloc(len + 1);
-                if (p_tk->value.txt == NULL)
-                        LEX_ERR("Failed memory alloc for keyword");
-                p_tk->value.txt[len] = '\0';
-                memcpy(p_tk->value.txt, txt_start, len);
+                // slice of the source, no copy unless streaming
+                p_tk->value.txt = keep_src_txt(p_lex, txt_start, (long) len);
+                p_tk->len = (long) len;
         }
         else {
                 p_tk->type_group = G_KEYWORD;
@@ -264,7 +790,7 @@ static void lex_keyword_or_identifier(struct Tk *p_tk)
 
 
 // Only *ascii* chars will be supported, may be changed to *utf-8*, and allow wide chars
-static void lex_char(struct Tk *p_tk)
+static void lex_char(struct Lexer *p_lex, struct Tk *p_tk)
 {
         p_tk->type_group = G_LITERAL;
         p_tk->type = LIT_CHAR;
@@ -279,55 +805,60 @@ static void lex_char(struct Tk *p_tk)
                 if (esc_char == -1)
                         LEX_ERR("Invalid escape sequence");
                 p_tk->value.c = (char) esc_char;
-                        
+                INCPOS();
+        }
+        else if (c == '\t') {
+                p_tk->value.c = c;
+                handle_tab_char(p_lex);
         }
-        else if (c == '\t')
-                handle_tab_char();
-        else if (!isalnum(c) && !isspace(c) && !ispunct(c) && c != '_')
+        else if (!IS_LIT(c))
                 LEX_ERR("Invalid character literal.");
-        INCPOS();
+        else {
+                p_tk->value.c = c;
+                INCPOS();
+        }
         c = GET_C();
         if (c != '\'')
                 LEX_ERR("Expected ''' to end character literal.");
         INCPOS();
 }
 
-// so efficient!
-static void lex_str(struct Tk *p_tk)
+// One pass, a slice of the source unless there are escapes,
+// then it's decoded into the arena from the first escape on
+static void lex_str(struct Lexer *p_lex, struct Tk *p_tk)
 {
         p_tk->type_group = G_LITERAL;
         p_tk->type = LIT_STR;
-        long src_i_start = src_i;
-        long escape_seq_count = 0;
+        const char *txt_start = p_lex->src_txt + p_lex->src_i;
+        struct StrBuild sb;
+        bool has_escapes = false;
         char c;
         // starts on the char after the beginning '"'
-        while ((c = GET_C()) != '"') {
+        while (true) {
+                // plain runs are skipped (or copied once there are escapes) a block at a time
+                long run_start = p_lex->src_i;
+                simd_skip(p_lex, SKIP_STR);
+                if (has_escapes && p_lex->src_i != run_start &&
+                    !strbuild_append(&sb, p_lex->src_txt + run_start, (size_t) (p_lex->src_i - run_start)))
+                        LEX_ERR("Failed memory alloc for string literal");
+                if ((c = GET_C()) == '"')
+                        break;
                 if (c == '\0' || c == '\n') {
                         // read at last char of string
                         DECPOS();
                         LEX_ERR("Unclosed string literal.");
                 }
                 else if (c == '\\') {
+                        if (!has_escapes) {
+                                has_escapes = true;
+                                strbuild_init(&sb, p_lex->p_arena);
+                                if (!strbuild_append(&sb, txt_start, (size_t) (p_lex->src_txt + p_lex->src_i - txt_start)))
+                                        LEX_ERR("Failed memory alloc for string literal");
+                        }
                         c = NEXT_C();
-                        escape_seq_count++;
-                        if (c != '\0' && c != '\n')
-                                INCPOS();
-                }
-                INCPOS();
-        }
-
-        // why
-        long len = (src_i - src_i_start) - escape_seq_count;
-        p_tk->value.txt = malloc((size_t) len + 1);
-        if (p_tk->value.txt == NULL)
-                LEX_ERR("Failed memory alloc for string literal");
-        p_tk->value.txt[len] = '\0';
-        SET_POS(src_i_start);
-
-        for (long i = 0; i < len; i++) {
-                if ((c = GET_C()) == '\\') {
+                        if (c == '\0' || c == '\n')
+                                LEX_ERR("Unclosed string literal.");
                         INCPOS();
-                        c = GET_C();
                         int esc_char = esc_seq_from_char(c);
                         if (esc_char == -1)
                                 LEX_ERR("Invalid escape sequence");
@@ -335,63 +866,81 @@ static void lex_str(struct Tk *p_tk)
                         INCPOS();
                 }
                 else if (c == '\t')
-                        handle_tab_char();
+                        handle_tab_char(p_lex);
                 // prob needs rework idk for other special chars
                 else {
-                        if (!isalnum(c) && !isspace(c) && !ispunct(c))
+                        if (!IS_LIT(c))
                                 LEX_ERR("Invalid character in string literal");
                         INCPOS();
                 }
-                p_tk->value.txt[i] = c;
+                if (has_escapes && !strbuild_push(&sb, c))
+                        LEX_ERR("Failed memory alloc for string literal");
+        }
+
+        if (has_escapes) {
+                size_t len;
+                if ((p_tk->value.txt = strbuild_finish(&sb, &len)) == NULL)
+                        LEX_ERR("Failed memory alloc for string literal");
+                p_tk->len = (long) len;
+        } else {
+                p_tk->len = (long) (p_lex->src_txt + p_lex->src_i - txt_start);
+                p_tk->value.txt = keep_src_txt(p_lex, txt_start, p_tk->len);
         }
         // char after ending '"'
         INCPOS();
 }
 
 // whitespace characters are non-printable characters that define text layouts
-static bool handle_whitespace(void)
+static bool handle_whitespace(struct Lexer *p_lex)
 {
         char c = GET_C();
-        if (!isspace(c)) return false;
-        while (isspace(c = GET_C()))
+        if (!IS_SPACE(c)) return false;
+        simd_skip(p_lex, SKIP_SPACE);
+        while (IS_SPACE(c = GET_C()))
                 if (c == '\t')
-                        handle_tab_char();
+                        handle_tab_char(p_lex);
                 else if (c == '\n')
-                        handle_newline_char();
+                        handle_newline_char(p_lex);
                 else
                         INCPOS();
         return true;
 }
 
-static bool handle_line_comment(void)
+static bool handle_line_comment(struct Lexer *p_lex)
 {
         char c = GET_C();
         if (c != '/' || NEXT_C() != '/') return false;
         INCPOS();
+        simd_skip(p_lex, SKIP_LINE_COMMENT);
         for (c = GET_C(); c != '\n' && c != '\0'; c = GET_C())
                 if (c == '\t')
-                        handle_tab_char();
+                        handle_tab_char(p_lex);
                 else
                         INCPOS();
         return true;
 }
 
-static bool handle_multiline_comment(void)
+static bool handle_multiline_comment(struct Lexer *p_lex)
 {
         char c = GET_C();
         if (c != '/' || NEXT_C() != '*') return false;
-        long comment_src_line = src_line;
-        long comment_src_column = src_column;
+        long comment_src_line = p_lex->src_line;
+        long comment_src_column = p_lex->src_column;
         INCPOS();
+        simd_skip(p_lex, SKIP_BLOCK_COMMENT);
+        // when streaming, each line is made whole before it's scanned so '*/' is never split
+        stream_fill_line(p_lex);
         for (c = GET_C(); c != '*' || NEXT_C() != '/'; c = GET_C())
                 if (c == '\0')
                         LEX_ERR_FMT("Unclosed multiline comment "
                                     "starting at (L%ld C%ld)",
                                     comment_src_line,comment_src_column);
                 else if (c == '\t')
-                        handle_tab_char();
-                else if (c == '\n')
-                        handle_newline_char();
+                        handle_tab_char(p_lex);
+                else if (c == '\n') {
+                        handle_newline_char(p_lex);
+                        stream_fill_line(p_lex);
+                }
                 else
                         INCPOS();
 
@@ -402,283 +951,820 @@ static bool handle_multiline_comment(void)
 }
 
 // probably the worst thing written on here
-static inline void handle_non_lexable(void)
+// 'stream_fill_line' goes 1st so comments & tokens always start on a whole line
+static inline void handle_non_lexable(struct Lexer *p_lex)
 {
-        while (handle_whitespace() || handle_line_comment() ||
-               handle_multiline_comment());
+        while (stream_fill_line(p_lex) || handle_whitespace(p_lex) ||
+               handle_line_comment(p_lex) || handle_multiline_comment(p_lex));
 }
 
-static inline void init_keywords_map(void)
+static inline void init_keywords_map(struct Lexer *p_lex)
 {
-        hashmap_init(&keywords_hashmap, HASHMAP_INIT_SIZE);
+        hashmap_init(&p_lex->keywords_hashmap, HASHMAP_INIT_SIZE);
         for (int i = 0; i < (int) (sizeof keywords / sizeof *keywords); i++)
                 // Keyword enums are in order startiing from 'KW_BOOL'
-                hashmap_put_int(&keywords_hashmap, keywords[i], strlen(keywords[i]),
+                hashmap_put_int(&p_lex->keywords_hashmap, keywords[i], strlen(keywords[i]),
                                 (int) KW_BOOL + i);
 }
 
-// TODO: deal with 'src_i' & 'column'
-// IDK: find a way to clean up repititve code
-enum TkType lex_next(struct Tk *p_tk)
+// The token at 'src_i', whitespace & comments are already skipped
+// Only sets what the token type uses, no 'memset' of the whole token
+static inline void lex_token(struct Lexer *p_lex, struct Tk *p_tk)
 {
-        handle_non_lexable();
-        memset(p_tk, 0, sizeof(struct Tk));
-        p_tk->line = src_line;
-        p_tk->column = src_column;
-        
-        char c;
-        switch (c = GET_C()) {
-        case '=':
-                INCPOS();
-                if (GET_C() == '=') {
-                        INCPOS();
-                        p_tk->type_group = G_OP_LOGICAL;
-                        p_tk->type = OP_EQ;
-                }
-                else {
-                        p_tk->type_group = G_OP_ASSIGN;
-                        p_tk->type = OP_AS;
-                }
-                break;
-        case '+':
-                INCPOS();
-                if (GET_C() == '+') {
-                        INCPOS();
-                        p_tk->type_group = G_OP_ARITH;
-                        p_tk->type = OP_INC;
-                } else
-                        lex_op_other_or_assign(p_tk, G_OP_ARITH, OP_SUB, OP_SUB_AS);
-                break;
-        case '-':
-                INCPOS();
-                if (GET_C() == '-') {
-                        INCPOS();
-                        p_tk->type_group = G_OP_ARITH;
-                        p_tk->type = OP_DEC;
-                }
-                else
-                        lex_op_other_or_assign(p_tk, G_OP_ARITH, OP_SUB, OP_SUB_AS);
-                break;
-        case '/':
-                INCPOS();
-                lex_op_other_or_assign(p_tk, G_OP_ARITH, OP_DIV, OP_DIV_AS);
-                break;
-        case '*':
-                INCPOS();
-                lex_op_other_or_assign(p_tk, G_OP_ARITH, OP_MUL, OP_MUL_AS);
-                break;
-        case '!':
-                INCPOS();
-                if (GET_C() == '=') {
-                        INCPOS();
-                        p_tk->type_group = G_OP_LOGICAL;
-                        p_tk->type = OP_NOT_EQ;
-                } else {
-                        p_tk->type_group = G_OP_LOGICAL;
-                        p_tk->type = OP_NOT;
-                } 
-                break;
-        case '^':
-                INCPOS();
-                if (GET_C() == '^') {
-                        INCPOS();
-                        lex_op_other_or_assign(p_tk, G_OP_BITWISE, OP_BXOR, OP_BXOR_AS);
-                } else
-                        lex_op_other_or_assign(p_tk, G_OP_ARITH, OP_POW, OP_POW_AS);
-                break;
-        case '%':
-                INCPOS();
-                lex_op_other_or_assign(p_tk, G_OP_ARITH, OP_MOD, OP_MOD_AS);
-                break;
-        case '&':
-                INCPOS();
-                // maybe add incpos before switch statement?
-                if (GET_C() == '&') {
-                        INCPOS();
-                        p_tk->type_group = G_OP_LOGICAL;
-                        p_tk->type = OP_AND;
-                } else
-                        lex_op_other_or_assign(p_tk, G_OP_BITWISE, OP_BAND, OP_BAND);
-                break;
-        case '|':
-                INCPOS();
-                if (GET_C() == '|') {
-                        INCPOS();
-                        p_tk->type_group = G_OP_LOGICAL;
-                        p_tk->type = OP_OR;
-                } else
-                        lex_op_other_or_assign(p_tk, G_OP_BITWISE, OP_BOR, OP_BOR_AS);
-                break;
-        case '<':
-                INCPOS();
-                if (GET_C() == '<') {
-                        INCPOS();
-                        lex_op_other_or_assign(p_tk, G_OP_BITWISE, OP_BSHL, OP_BSHL_AS);
-                } else {
-                        if (GET_C() == '=') {
-                                INCPOS();
-                                p_tk->type_group = G_OP_LOGICAL;
-                                p_tk->type = OP_LESS_OR_EQ;
-                        } else { 
-                                p_tk->type_group = G_OP_LOGICAL;
-                                p_tk->type = OP_LESS;
-                        }
-                }
-                break;
-        case '>':
-                INCPOS();
-                if (GET_C() == '>') {
-                        INCPOS();
-                        lex_op_other_or_assign(p_tk, G_OP_BITWISE, OP_BSHR, OP_BSHR_AS);
-                } else {
-                        if (GET_C() == '=') {
-                                INCPOS();
-                                p_tk->type_group = G_OP_LOGICAL;
-                                p_tk->type = OP_GREATER_OR_EQ;
-                        } else { 
-                                p_tk->type_group = G_OP_LOGICAL;
-                                p_tk->type = OP_GREATER;
-                        }
-                }
-                break;
-        case '[':
-                INCPOS();
-                p_tk->type_group = G_MISC;
-                p_tk->type = BRACKET_L;
-                break;
-        case ']':
-                INCPOS();
-                p_tk->type_group = G_MISC;
-                p_tk->type = BRACKET_R;
-                break;
-        case '{':
-                INCPOS();
-                p_tk->type_group = G_MISC;
-                p_tk->type = BRACE_L;
-                break;
-        case '}':
-                INCPOS();
-                p_tk->type_group = G_MISC;
-                p_tk->type = BRACE_R;
-                break;
-        case '(':
-                INCPOS();
-                p_tk->type_group = G_MISC;
-                p_tk->type = PAREN_L;
-                break;
-        case ')':
-                INCPOS();
-                p_tk->type_group = G_MISC;
-                p_tk->type = PAREN_R;
-                break;
-        case '?':
-                INCPOS();
-                p_tk->type_group = G_MISC;
-                p_tk->type = QUESTION;
-                break;
-        case ':':
+        char c = GET_C();
+        switch ((enum TkStart) tk_start[(unsigned char) c]) {
+        case TS_SINGLE:
                 INCPOS();
                 p_tk->type_group = G_MISC;
-                p_tk->type = COLON;
+                p_tk->type = (enum TkType) single_tks[(unsigned char) c];
                 break;
-        case '\'':        // 'LIT_CHAR'
+        case TS_OP:
                 INCPOS();
-                lex_char(p_tk);
+                lex_op(p_lex, p_tk, c);
                 break;
-        case '"':        // 'LIT_STR'
-                INCPOS();
-                lex_str(p_tk);
+        case TS_IDENT:
+                lex_keyword_or_identifier(p_lex, p_tk);
                 break;
-        case '0':
+        case TS_ZERO:
                 INCPOS();
                 c = GET_C();
                 if (c == 'x') {
                         INCPOS();
-                        lex_hex_int(p_tk);
+                        lex_hex_int(p_lex, p_tk);
                 } else if (c == 'b') {
                         INCPOS();
-                        lex_bin_int(p_tk);
+                        lex_bin_int(p_lex, p_tk);
                 } else {
                         DECPOS();
-                        lex_dec_int_or_num(p_tk);
+                        lex_dec_int_or_num(p_lex, p_tk);
                 }
                 break;
-        case '.':
+        case TS_DIGIT:
+                lex_dec_int_or_num(p_lex, p_tk);
+                break;
+        case TS_PERIOD:
                 // no incpos, 'lex_num' needs to read '.' for fraction
-                if (isdigit(NEXT_C()))
-                        lex_num(p_tk);
+                if (IS_DIGIT(NEXT_C()))
+                        lex_num(p_lex, p_tk);
                 else {
                         INCPOS();
                         p_tk->type_group = G_MISC;
                         p_tk->type = PERIOD;
                 }
                 break;
-        case '_':
-                lex_keyword_or_identifier(p_tk);
+        case TS_CHAR:
+                INCPOS();
+                lex_char(p_lex, p_tk);
+                break;
+        case TS_STR:
+                INCPOS();
+                lex_str(p_lex, p_tk);
                 break;
-        case '\0':
-                if (src_i != src_len)
+        case TS_END:
+                if (p_lex->src_i != p_lex->src_len)
                         LEX_ERR("Null terminator '\\0' should be at end of file");
                 p_tk->type_group = G_MISC;
                 p_tk->type = END;
-                // cleanup, since end of file
-                hashmap_free(&keywords_hashmap);
                 break;
+        case TS_BAD:
         default:
-                if (isdigit(c))
-                        lex_dec_int_or_num(p_tk);
-                else if (isalpha(c))
-                        lex_keyword_or_identifier(p_tk);
+                // Should have more debugging, to handle non-printable characters
+                // Default argument promotions promote 'c' to 'int', but explicitness just to be fine
+                if (IS_LIT(c) && !IS_SPACE(c))
+                        LEX_ERR_FMT("Invalid symbol '%c', character code of %d", c, (int) c);
                 else
-                        // Should have more debugging, to handle non-printable characters
-                        // Default argument promotions promote 'c' to 'int', but explicitness just to be fine
-                        if (isprint(c))
-                                LEX_ERR_FMT("Invalid symbol '%c', character code of %d", c, (int) c);
-                        else
-                                LEX_ERR_FMT("Invalid non-printable symbol, character code of %d", (int) c);
+                        LEX_ERR_FMT("Invalid non-printable symbol, character code of %d", (int) c);
         }
+}
 
+enum TkType lexer_next(struct Lexer *p_lex, struct Tk *p_tk)
+{
+        handle_non_lexable(p_lex);
+        p_tk->line = p_lex->src_line;
+        p_tk->column = p_lex->src_column;
+        lex_token(p_lex, p_tk);
         return p_tk->type;
 }
 
-// should probably rework this to buffer instead of copying into a file
-void lex_init(const char *file_name)
+// The enum is in group order
+static enum TkTypeGroup tk_type_group(enum TkType type)
+{
+        if (type <= OP_BXOR_AS)
+                return G_OP_ASSIGN;
+        if (type <= OP_MOD)
+                return G_OP_ARITH;
+        if (type <= OP_OR)
+                return G_OP_LOGICAL;
+        if (type <= OP_BOR)
+                return G_OP_BITWISE;
+        if (type <= KW_FN)
+                return G_KEYWORD;
+        if (type <= LIT_NIL)
+                return G_LITERAL;
+        return G_MISC;
+}
+
+static uint32_t tk_stream_value(struct Lexer *p_lex, struct TkStream *p_stream, union TkValue value)
+{
+        if (p_stream->values_len == p_stream->values_cap) {
+                size_t cap = p_stream->values_cap == 0 ? 64 : p_stream->values_cap * 2;
+                union TkValue *values = realloc(p_stream->values, cap * sizeof *values);
+                if (values == NULL)
+                        LEX_ERR("Failed memory alloc for token stream");
+                p_stream->values = values;
+                p_stream->values_cap = cap;
+        }
+        p_stream->values[p_stream->values_len] = value;
+        return (uint32_t) p_stream->values_len++;
+}
+
+// The 3 arrays are one allocation, 'offsets' then 'payloads' then 'types', each 'cap' long
+// with the tokens past the gap at their end
+static void tk_stream_reserve(struct Lexer *p_lex, struct TkStream *p_stream, size_t cap)
+{
+        size_t old_cap = p_stream->cap;
+        if (cap <= old_cap)
+                return;
+        if (cap < old_cap * 2)
+                cap = old_cap * 2;
+        if (cap > SIZE_MAX / 9)
+                LEX_ERR("Failed memory alloc for token stream");
+        char *block = realloc(p_stream->offsets, cap * 9);
+        if (block == NULL)
+                LEX_ERR("Failed memory alloc for token stream");
+        // everything only moves up, so it's moved from the top down
+        size_t head = p_stream->gap, tail = p_stream->len - p_stream->gap;
+        memmove(block + cap * 9 - tail, block + old_cap * 9 - tail, tail);
+        memmove(block + cap * 8, block + old_cap * 8, head);
+        memmove(block + cap * 8 - tail * 4, block + old_cap * 8 - tail * 4, tail * sizeof(uint32_t));
+        memmove(block + cap * 4, block + old_cap * 4, head * sizeof(uint32_t));
+        memmove(block + cap * 4 - tail * 4, block + old_cap * 4 - tail * 4, tail * sizeof(uint32_t));
+        p_stream->offsets = (uint32_t *) (void *) block;
+        p_stream->payloads = (uint32_t *) (void *) (block + cap * 4);
+        p_stream->types = (uint8_t *) (block + cap * 8);
+        p_stream->cap = cap;
+}
+
+// Into the gap, after the tokens before it
+static void tk_stream_append(struct Lexer *p_lex, struct TkStream *p_stream,
+                             enum TkType type, long offset, uint32_t payload)
+{
+        if (p_stream->len == p_stream->cap)
+                tk_stream_reserve(p_lex, p_stream, p_stream->len + 1);
+        size_t i = p_stream->gap++;
+        p_stream->types[i] = (uint8_t) type;
+        p_stream->offsets[i] = (uint32_t) offset;
+        p_stream->payloads[i] = payload;
+        p_stream->len++;
+}
+
+static size_t tk_stream_slot(const struct TkStream *p_stream, size_t i)
+{
+        return i < p_stream->gap ? i : i + p_stream->cap - p_stream->len;
+}
+
+static long tk_stream_slot_offset(const struct TkStream *p_stream, size_t slot)
+{
+        uint32_t offset = p_stream->offsets[slot];
+        return slot < p_stream->gap ? (long) offset : p_stream->src_len - (long) offset;
+}
+
+// Tokens past the gap keep their offset from the end of the source, so an edit before them doesn't shift them
+static void tk_stream_move_gap(struct TkStream *p_stream, size_t gap)
+{
+        size_t gap_len = p_stream->cap - p_stream->len;
+        uint32_t src_len = (uint32_t) p_stream->src_len;
+        for (size_t i = p_stream->gap; i > gap; i--) {
+                p_stream->types[i - 1 + gap_len] = p_stream->types[i - 1];
+                p_stream->payloads[i - 1 + gap_len] = p_stream->payloads[i - 1];
+                p_stream->offsets[i - 1 + gap_len] = src_len - p_stream->offsets[i - 1];
+        }
+        for (size_t i = p_stream->gap; i < gap; i++) {
+                p_stream->types[i] = p_stream->types[i + gap_len];
+                p_stream->payloads[i] = p_stream->payloads[i + gap_len];
+                p_stream->offsets[i] = src_len - p_stream->offsets[i + gap_len];
+        }
+        p_stream->gap = gap;
+}
+
+// The values left by tokens that were replaced are dropped once they're half of them
+static void tk_stream_compact_values(struct TkStream *p_stream)
+{
+        size_t live = p_stream->values_len - p_stream->values_dead;
+        size_t cap = live < 64 ? 64 : live;
+        union TkValue *values = malloc(cap * sizeof *values);
+        if (values == NULL)
+                return;
+        size_t n = 0;
+        for (size_t i = 0; i < p_stream->len; i++) {
+                size_t slot = tk_stream_slot(p_stream, i);
+                enum TkType type = (enum TkType) p_stream->types[slot];
+                uint32_t payload = p_stream->payloads[slot];
+                if (type == LIT_INT || type == LIT_NUM) {
+                        values[n] = p_stream->values[payload];
+                        p_stream->payloads[slot] = (uint32_t) n++;
+                } else if ((type == LIT_STR || type == IDENTIFIER) && (payload & TK_PAYLOAD_DECODED)) {
+                        payload &= ~TK_PAYLOAD_DECODED;
+                        values[n] = p_stream->values[payload];
+                        values[n + 1] = p_stream->values[payload + 1];
+                        p_stream->payloads[slot] = TK_PAYLOAD_DECODED | (uint32_t) n;
+                        n += 2;
+                }
+        }
+        free(p_stream->values);
+        p_stream->values = values;
+        p_stream->values_len = n;
+        p_stream->values_cap = cap;
+        p_stream->values_dead = 0;
+}
+
+static void tk_stream_push(struct Lexer *p_lex, struct TkStream *p_stream, const struct Tk *p_tk, long offset)
+{
+        enum TkType type = p_tk->type;
+        uint32_t payload = 0;
+        if (type == LIT_INT || type == LIT_NUM)
+                payload = tk_stream_value(p_lex, p_stream, p_tk->value);
+        else if (type == LIT_CHAR)
+                payload = (unsigned char) p_tk->value.c;
+        else if (type == LIT_STR || type == IDENTIFIER) {
+                if (p_tk->value.txt == p_lex->src_txt + offset + (type == LIT_STR))
+                        payload = (uint32_t) p_tk->len;
+                else {
+                        // decoded, the text then its length
+                        payload = TK_PAYLOAD_DECODED | tk_stream_value(p_lex, p_stream, p_tk->value);
+                        tk_stream_value(p_lex, p_stream, (union TkValue) { .int_v = p_tk->len });
+                }
+        }
+        tk_stream_append(p_lex, p_stream, p_tk->type, offset, payload);
+}
+
+// Tokens starting before 'end', returns where the next one starts, past 'src_len' after 'END'
+static long lex_stream_until(struct Lexer *p_lex, struct TkStream *p_stream, long end)
+{
+        struct Tk tk;
+        while (true) {
+                handle_non_lexable(p_lex);
+                long offset = p_lex->src_i;
+                if (offset >= end)
+                        return offset;
+                lex_token(p_lex, &tk);
+                tk_stream_push(p_lex, p_stream, &tk, offset);
+                if (tk.type == END)
+                        return p_lex->src_len + 1;
+        }
+}
+
+static void tk_stream_start(struct Lexer *p_lex, struct TkStream *p_stream)
+{
+        if (p_lex->src_stream != NULL)
+                LEX_ERR("A token stream needs the whole source, it can't be streamed");
+        if (p_lex->src_len >= (long) TK_PAYLOAD_DECODED)
+                LEX_ERR("Source too large for a token stream, 2 GB at most");
+        memset(p_stream, 0, sizeof *p_stream);
+        p_stream->src_txt = p_lex->src_txt;
+        p_stream->src_len = p_lex->src_len;
+        p_stream->src_start = p_lex->src_i;
+        // a guess so most sources never grow, short tokens & a space each
+        tk_stream_reserve(p_lex, p_stream, (size_t) (p_lex->src_len - p_lex->src_i) / 4 + 1);
+}
+
+// Index of the token starting at 'offset' in [0, 'len') of a stream without tokens past its gap, -1 if none does
+static long tk_stream_find(const struct TkStream *p_stream, size_t len, long offset)
+{
+        size_t lo = 0, hi = len;
+        while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (p_stream->offsets[mid] < (uint32_t) offset)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        return lo < len && p_stream->offsets[lo] == (uint32_t) offset ? (long) lo : -1;
+}
+
+// Moves forward to 'offset' from a known line & column, counted the way the lexer does
+static void lexer_seek(struct Lexer *p_lex, long from, long line, long column, long offset)
+{
+        for (long i = from; i < offset; i++)
+                if (p_lex->src_txt[i] == '\n') {
+                        line++;
+                        column = 0;
+                } else
+                        column += p_lex->src_txt[i] == '\t' ? TAB_WIDTH : 1;
+        p_lex->src_i = offset;
+        p_lex->src_line = line;
+        p_lex->src_column = column;
+}
+
+void lex_all(struct Lexer *p_lex, struct TkStream *p_stream)
+{
+        tk_stream_start(p_lex, p_stream);
+        lex_stream_until(p_lex, p_stream, p_lex->src_len + 1);
+}
+
+#ifdef __linux__
+/*
+  Each chunk starts on a line, no token spans one, so a chunk lexed on its own is right
+  unless it starts inside a block comment, that's the speculation
+  A chunk is checked by where its predecessor's last token ends: from the 1st token of the chunk
+  starting there on, it's the same tokens the sequential lexer would give, since lexing only
+  depends on where it starts. The tokens before that were inside a comment & are dropped,
+  a chunk with no such token is relexed from there until it lines up again
+  Errors in a worker longjmp out & the rest of its chunk is relexed, so only real errors are reported
+*/
+struct LexWorker {
+        struct Lexer lexer;
+        struct Arena arena;     // decoded text of 'stream', dropped with it once merged
+        struct TkStream stream;
+        long start;
+        long end;
+        long resume;            // where the token after the chunk starts
+        long newlines;          // in [start, end)
+        bool failed;            // the last token in 'stream' may be cut short
+        pthread_t thread;
+};
+
+static void *lex_worker(void *arg)
+{
+        struct LexWorker *p_w = arg;
+        jmp_buf err_jmp;
+        long newlines = 0;
+        for (const char *p = p_w->lexer.src_txt + p_w->start, *end = p_w->lexer.src_txt + p_w->end; p != end; p++)
+                newlines += *p == '\n';
+        p_w->newlines = newlines;
+        p_w->lexer.p_err_jmp = &err_jmp;
+        if (setjmp(err_jmp) == 0) {
+                memset(&p_w->stream, 0, sizeof p_w->stream);
+                tk_stream_reserve(&p_w->lexer, &p_w->stream, (size_t) (p_w->end - p_w->start) / 4 + 1);
+                p_w->resume = lex_stream_until(&p_w->lexer, &p_w->stream, p_w->end);
+        } else
+                p_w->failed = true;
+        return NULL;
+}
+
+// Tokens [from, to) of a worker's stream, its values & decoded strings out of its arena are copied
+static void tk_stream_append_range(struct Lexer *p_lex, struct TkStream *p_stream,
+                                   const struct TkStream *p_from, size_t from, size_t to)
+{
+        size_t n = to - from;
+        if (p_stream->len + n > p_stream->cap)
+                tk_stream_reserve(p_lex, p_stream, p_stream->len + n);
+        size_t at = p_stream->gap;
+        memcpy(p_stream->types + at, p_from->types + from, n);
+        memcpy(p_stream->offsets + at, p_from->offsets + from, n * sizeof(uint32_t));
+        for (size_t i = 0; i < n; i++) {
+                uint32_t payload = p_from->payloads[from + i];
+                enum TkType type = (enum TkType) p_from->types[from + i];
+                if (type == LIT_INT || type == LIT_NUM)
+                        payload = tk_stream_value(p_lex, p_stream, p_from->values[payload]);
+                else if ((type == LIT_STR || type == IDENTIFIER) && (payload & TK_PAYLOAD_DECODED)) {
+                        payload &= ~TK_PAYLOAD_DECODED;
+                        const char *txt = p_from->values[payload].txt;
+                        size_t txt_len = (size_t) p_from->values[payload + 1].int_v;
+                        char *copy = arena_alloc(p_lex->p_arena, txt_len + 1);
+                        if (copy == NULL)
+                                LEX_ERR("Failed memory alloc for token stream");
+                        memcpy(copy, txt, txt_len + 1);
+                        payload = TK_PAYLOAD_DECODED | tk_stream_value(p_lex, p_stream, (union TkValue) { .txt = copy });
+                        tk_stream_value(p_lex, p_stream, (union TkValue) { .int_v = (int64_t) txt_len });
+                }
+                p_stream->payloads[at + i] = payload;
+        }
+        p_stream->gap += n;
+        p_stream->len += n;
+}
+
+void lex_all_parallel(struct Lexer *p_lex, struct TkStream *p_stream, int n_threads)
+{
+        long src_start = p_lex->src_i;
+        long n_chunks = (p_lex->src_len - src_start) / LEX_PARALLEL_MIN_CHUNK;
+        if (n_chunks > n_threads)
+                n_chunks = n_threads;
+        if (n_chunks <= 1) {
+                lex_all(p_lex, p_stream);
+                return;
+        }
+        tk_stream_start(p_lex, p_stream);
+        struct LexWorker *workers = calloc((size_t) n_chunks, sizeof *workers);
+        if (workers == NULL)
+                LEX_ERR("Failed memory alloc for lexer workers");
+
+        // split on the line after each even share, past 'src_len' for the last so 'END' is in it
+        long chunk_len = (p_lex->src_len - src_start) / n_chunks;
+        for (long k = 0; k < n_chunks; k++) {
+                struct LexWorker *p_w = &workers[k];
+                p_w->start = k == 0 ? src_start : workers[k - 1].end;
+                if (k == n_chunks - 1)
+                        p_w->end = p_lex->src_len + 1;
+                else {
+                        const char *nl = memchr(p_lex->src_txt + src_start + (k + 1) * chunk_len, '\n',
+                                                (size_t) (p_lex->src_len - src_start - (k + 1) * chunk_len));
+                        p_w->end = nl == NULL ? p_lex->src_len : nl + 1 - p_lex->src_txt;
+                        if (p_w->end < p_w->start)
+                                p_w->end = p_w->start;
+                }
+                p_w->lexer = *p_lex;
+                p_w->lexer.src_i = p_w->start;
+                p_w->lexer.src_line = 1;
+                p_w->lexer.src_column = 0;
+                // speculative, nothing is reported from it
+                p_w->lexer.warned_tab_width = true;
+                arena_init(&p_w->arena, SRC_WORKER_ARENA_SIZE);
+                p_w->lexer.p_arena = &p_w->arena;
+        }
+        // chunk 0 is on this thread, a worker that can't be started is run here too
+        for (long k = 1; k < n_chunks; k++)
+                if (pthread_create(&workers[k].thread, NULL, lex_worker, &workers[k]) != 0) {
+                        lex_worker(&workers[k]);
+                        workers[k].thread = pthread_self();
+                }
+        lex_worker(&workers[0]);
+        for (long k = 1; k < n_chunks; k++)
+                if (!pthread_equal(workers[k].thread, pthread_self()))
+                        pthread_join(workers[k].thread, NULL);
+
+        // 'resume' of what's merged so far, the main lexer relexes from there when a chunk doesn't line up
+        long resume = src_start;
+        long src_start_line = p_lex->src_line;
+        long src_start_column = p_lex->src_column;
+        long start_line = src_start_line;
+        long start_column = src_start_column;
+        for (long k = 0; k < n_chunks; k++) {
+                struct LexWorker *p_w = &workers[k];
+                const struct TkStream *p_from = &p_w->stream;
+                // the token after the failed one is unknown, so the last one is relexed to find it
+                size_t valid = p_from->len - (p_w->failed && p_from->len != 0);
+                if (resume < p_w->end) {
+                        long i = tk_stream_find(p_from, valid, resume);
+                        if (i == -1) {
+                                // out of line, relex until a token starts where the worker's did
+                                if (p_lex->src_i != resume)
+                                        lexer_seek(p_lex, p_w->start, start_line, start_column, resume);
+                                struct Tk tk;
+                                while (true) {
+                                        handle_non_lexable(p_lex);
+                                        resume = p_lex->src_i;
+                                        if (resume >= p_w->end ||
+                                            (i = tk_stream_find(p_from, valid, resume)) != -1)
+                                                break;
+                                        lex_token(p_lex, &tk);
+                                        tk_stream_push(p_lex, p_stream, &tk, resume);
+                                        if (tk.type == END) {
+                                                resume = p_lex->src_len + 1;
+                                                break;
+                                        }
+                                }
+                        }
+                        if (i != -1) {
+                                tk_stream_append_range(p_lex, p_stream, p_from, (size_t) i, valid);
+                                if (!p_w->failed)
+                                        resume = p_w->resume;
+                                else {
+                                        // relexing the rest reports the error with the right position
+                                        resume = (long) p_from->offsets[valid];
+                                        lexer_seek(p_lex, p_w->start, start_line, start_column, resume);
+                                        resume = lex_stream_until(p_lex, p_stream, p_w->end);
+                                }
+                        }
+                }
+                start_line += p_w->newlines;
+                start_column = 0;
+                tk_stream_free(&p_w->stream);
+                arena_clear(&p_w->arena);
+        }
+        free(workers);
+        // where the sequential lexer would've ended, after 'END'
+        long last_nl = p_lex->src_len;
+        while (last_nl > src_start && p_lex->src_txt[last_nl - 1] != '\n')
+                last_nl--;
+        if (last_nl == src_start)
+                lexer_seek(p_lex, src_start, src_start_line, src_start_column, p_lex->src_len);
+        else
+                lexer_seek(p_lex, last_nl, start_line, 0, p_lex->src_len);
+}
+#else
+void lex_all_parallel(struct Lexer *p_lex, struct TkStream *p_stream, int n_threads)
+{
+        (void) n_threads;
+        lex_all(p_lex, p_stream);
+}
+#endif
+
+// Relexes into the gap until a token starts where an old one past the edit did, returns how many old ones it replaces
+static size_t relex_until_aligned(struct Lexer *p_lex, struct TkStream *p_stream, long edit_end)
 {
+        struct Tk tk;
+        // the old tokens are all past the gap, as many as there are for the whole relex
+        size_t n_old = p_stream->len - p_stream->gap;
+        size_t old_i = 0;
+        while (true) {
+                handle_non_lexable(p_lex);
+                long offset = p_lex->src_i;
+                // they're counted from the end of the new source, right for those after the edit
+                long old_offset = 0;
+                for (; old_i < n_old; old_i++) {
+                        old_offset = p_lex->src_len - (long) p_stream->offsets[p_stream->cap - n_old + old_i];
+                        if (old_offset >= offset)
+                                break;
+                }
+                // the text from here on is the same as before, so are the tokens
+                if (offset >= edit_end && old_i < n_old && old_offset == offset)
+                        return old_i;
+                lex_token(p_lex, &tk);
+                tk_stream_push(p_lex, p_stream, &tk, offset);
+                if (tk.type == END)
+                        return n_old;
+        }
+}
+
+/*
+  Lexing a token reads at most this past its end (the "e+" of "1e+5"), so a token
+  starting more than this before the edit is lexed the same, as is everything before it
+*/
+#define LEX_MAX_LOOKAHEAD 2
+
+void lex_relex(struct Lexer *p_lex, struct TkStream *p_stream, const char *new_src, long new_src_len,
+               const struct TkEdit *p_edit, struct TkRange *p_range)
+{
+        if (p_lex->src_stream != NULL)
+                LEX_ERR("A token stream needs the whole source, it can't be streamed");
+        if (new_src_len >= (long) TK_PAYLOAD_DECODED)
+                LEX_ERR("Source too large for a token stream, 2 GB at most");
+#ifdef __linux__
+        if (p_lex->src_map_len != 0)
+                munmap(p_lex->src_buf, p_lex->src_map_len);
+#endif
+        p_lex->src_map_len = 0;
+        p_lex->src_buf = NULL;
+        p_lex->src_txt = new_src;
+        p_lex->src_len = new_src_len;
+
+        // tokens [0, first) are kept as they are
+        size_t first = 0;
+        for (size_t hi = p_stream->len; first < hi; ) {
+                size_t mid = first + (hi - first) / 2;
+                if (tk_stream_slot_offset(p_stream, tk_stream_slot(p_stream, mid)) + LEX_MAX_LOOKAHEAD < p_edit->offset)
+                        first = mid + 1;
+                else
+                        hi = mid;
+        }
+        // the last of those is relexed too, its end may be past the edit
+        long restart = p_stream->src_start;
+        if (first != 0)
+                restart = tk_stream_slot_offset(p_stream, tk_stream_slot(p_stream, --first));
+        long edit_end = p_edit->offset + p_edit->inserted_len;
+        // the new tokens go into the gap, the old ones past it are only replaced once they line up
+        tk_stream_move_gap(p_stream, first);
+        size_t len = p_stream->len;
+        size_t values_len = p_stream->values_len;
+
+        // line & column aren't kept, they're only worked out (from the start) to report an error
+        jmp_buf err_jmp;
+        jmp_buf *p_caller_err_jmp = p_lex->p_err_jmp;
+        p_lex->p_err_jmp = &err_jmp;
+        size_t n_replaced;
+        if (setjmp(err_jmp) == 0) {
+                p_lex->src_i = restart;
+                n_replaced = relex_until_aligned(p_lex, p_stream, edit_end);
+        } else {
+                // nothing's replaced yet, dropping what was added leaves the stream as it was
+                p_stream->gap = first;
+                p_stream->len = len;
+                p_stream->values_len = values_len;
+                p_lex->p_err_jmp = p_caller_err_jmp;
+                if (p_caller_err_jmp != NULL)
+                        longjmp(*p_caller_err_jmp, 1);
+                // again from the same spot with the real line & column, for the error message
+                lexer_seek(p_lex, 0, 1, 0, restart);
+                n_replaced = relex_until_aligned(p_lex, p_stream, edit_end);
+        }
+        p_lex->p_err_jmp = p_caller_err_jmp;
+
+        // the replaced tokens are right after the gap, they join it
+        size_t n_new = p_stream->gap - first;
+        for (size_t slot = p_stream->cap - (p_stream->len - p_stream->gap), end = slot + n_replaced; slot != end; slot++) {
+                enum TkType type = (enum TkType) p_stream->types[slot];
+                if (type == LIT_INT || type == LIT_NUM)
+                        p_stream->values_dead++;
+                else if ((type == LIT_STR || type == IDENTIFIER) && (p_stream->payloads[slot] & TK_PAYLOAD_DECODED))
+                        p_stream->values_dead += 2;
+        }
+        p_stream->len -= n_replaced;
+        p_stream->src_txt = new_src;
+        p_stream->src_len = new_src_len;
+        if (p_stream->values_dead > p_stream->values_len / 2)
+                tk_stream_compact_values(p_stream);
+        p_range->first = (long) first;
+        p_range->old_end = (long) (first + n_replaced);
+        p_range->new_end = (long) (first + n_new);
+}
+
+enum TkType tk_stream_type(const struct TkStream *p_stream, long i)
+{
+        return (enum TkType) p_stream->types[tk_stream_slot(p_stream, (size_t) i)];
+}
+
+long tk_stream_offset(const struct TkStream *p_stream, long i)
+{
+        return tk_stream_slot_offset(p_stream, tk_stream_slot(p_stream, (size_t) i));
+}
+
+void tk_stream_get(const struct TkStream *p_stream, long i, struct Tk *p_tk)
+{
+        size_t slot = tk_stream_slot(p_stream, (size_t) i);
+        enum TkType type = (enum TkType) p_stream->types[slot];
+        uint32_t payload = p_stream->payloads[slot];
+        p_tk->type = type;
+        p_tk->type_group = tk_type_group(type);
+        p_tk->line = p_tk->column = 0;
+        if (type == LIT_INT || type == LIT_NUM)
+                p_tk->value = p_stream->values[payload];
+        else if (type == LIT_CHAR)
+                p_tk->value.c = (char) payload;
+        else if ((type == LIT_STR || type == IDENTIFIER) && (payload & TK_PAYLOAD_DECODED)) {
+                payload &= ~TK_PAYLOAD_DECODED;
+                p_tk->value.txt = p_stream->values[payload].txt;
+                p_tk->len = (long) p_stream->values[payload + 1].int_v;
+        }
+        else if (type == LIT_STR || type == IDENTIFIER) {
+                p_tk->value.txt = p_stream->src_txt + tk_stream_slot_offset(p_stream, slot) + (type == LIT_STR);
+                p_tk->len = (long) payload;
+        }
+}
+
+// Counted the same way the lexer does, from the start of the source, only meant for error messages
+void tk_stream_pos(const struct TkStream *p_stream, long i, long *p_line, long *p_column)
+{
+        long line = 1, column = 0;
+        const char *end = p_stream->src_txt + tk_stream_offset(p_stream, i);
+        for (const char *p = p_stream->src_txt; p != end; p++)
+                if (*p == '\n') {
+                        line++;
+                        column = 0;
+                } else
+                        column += *p == '\t' ? TAB_WIDTH : 1;
+        *p_line = line;
+        *p_column = column;
+}
+
+void tk_stream_free(struct TkStream *p_stream)
+{
+        free(p_stream->offsets);
+        free(p_stream->values);
+        memset(p_stream, 0, sizeof *p_stream);
+}
+
+#ifdef __linux__
+/*
+  Maps the file read-only, the kernel page cache backs it so there's no copy
+  The rest of the file's last page reads as zero, which is the '\0' sentinel,
+  an anonymous page is reserved under it for when the file ends on a page boundary
+  Returns false if it can't be mapped (e.g. a pipe), it's then read the normal way
+  NOTE: truncating the file while it's being lexed is a SIGBUS
+*/
+static bool map_src_file(struct Lexer *p_lex, FILE *src_file)
+{
+        int fd = fileno(src_file);
+        struct stat src_stat;
+        if (fstat(fd, &src_stat) != 0 || !S_ISREG(src_stat.st_mode))
+                return false;
+        size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+        size_t file_len = (size_t) src_stat.st_size;
+        size_t file_map_len = (file_len + page_size - 1) & ~(page_size - 1);
+        size_t map_len = (file_len + 1 + page_size - 1) & ~(page_size - 1);
+        char *map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+                return false;
+        if (file_map_len != 0 &&
+            mmap(map, file_map_len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+                munmap(map, map_len);
+                return false;
+        }
+        // read ahead aggressively, pages behind the lexer can be dropped early
+        madvise(map, map_len, MADV_SEQUENTIAL);
+        p_lex->src_txt = p_lex->src_buf = map;
+        p_lex->src_len = (long) file_len;
+        p_lex->src_map_len = map_len;
+        return true;
+}
+#else
+static bool map_src_file(struct Lexer *p_lex, FILE *src_file)
+{
+        (void) p_lex, (void) src_file;
+        return false;
+}
+#endif
+
+void lexer_free(struct Lexer *p_lex)
+{
+#ifdef __linux__
+        if (p_lex->src_map_len != 0)
+                munmap(p_lex->src_buf, p_lex->src_map_len);
+#endif
+        if (p_lex->src_stream != NULL) {
+                free(p_lex->src_buf);
+                if (p_lex->src_stream != stdin && fclose(p_lex->src_stream) != 0)
+                        PERREXIT("Failed to close source file");
+                p_lex->src_stream = NULL;
+        }
+        p_lex->src_map_len = 0;
+        p_lex->src_txt = p_lex->src_buf = NULL;
+        hashmap_free(&p_lex->keywords_hashmap);
+}
+
+static void lexer_reset(struct Lexer *p_lex, struct Arena *p_arena)
+{
+        p_lex->src_line = 1;
+        p_lex->src_column = 0;
+        p_lex->src_i = 0;
+        p_lex->src_buf = NULL;
+        p_lex->src_map_len = 0;
+        p_lex->src_stream = NULL;
+        p_lex->src_cap = 0;
+        p_lex->src_last_nl = -1;
+        p_lex->src_eof = false;
+        p_lex->p_err_jmp = NULL;
+        p_lex->p_arena = p_arena;
+        p_lex->warned_tab_width = false;
+}
+
+void lexer_init_stream(struct Lexer *p_lex, FILE *src_file, struct Arena *p_arena)
+{
+        lexer_reset(p_lex, p_arena);
+        p_lex->src_stream = src_file;
+        p_lex->src_cap = 2 * STREAM_CHUNK_SIZE;
+        if ((p_lex->src_buf = malloc((size_t) p_lex->src_cap)) == NULL)
+                PERREXIT("Failed to allocate source window");
+        p_lex->src_txt = p_lex->src_buf;
+        p_lex->src_len = 0;
+        p_lex->src_buf[0] = '\0';
+        // 1st line
+        stream_fill_line(p_lex);
+        init_keywords_map(p_lex);
+}
+
+// Maps the source if it can, copies it into the arena if it can be sized, streams it otherwise
+void lexer_init(struct Lexer *p_lex, const char *file_name, struct Arena *p_arena)
+{
+        if (strcmp(file_name, "-") == 0) {
+                lexer_init_stream(p_lex, stdin, p_arena);
+                return;
+        }
+        lexer_reset(p_lex, p_arena);
         FILE *src_file;
         if ((src_file = fopen(file_name, "r")) == NULL)
                 PERREXIT("Failed to open source file");
+        if (map_src_file(p_lex, src_file))
+                goto read_success;
 
         // fseek & ftell for portability to windows too ig???
-        if (fseek(src_file, 0, SEEK_END) != 0)
-                goto read_err;
-        if ((src_len = ftell(src_file)) == -1L)
-                goto read_err;
+        // neither works on a pipe, that's streamed instead
+        if (fseek(src_file, 0, SEEK_END) != 0 ||
+            (p_lex->src_len = ftell(src_file)) == -1L) {
+                lexer_init_stream(p_lex, src_file, p_arena);
+                return;
+        }
         if (fseek(src_file, 0, SEEK_SET) != 0)  // heard setting it to start is safe, i'm paranoid tho
                 goto read_err;
         // I would use a VLA but I can't gracefully handle those errors if a stack overflow happens
-        if ((src_txt = malloc((size_t) (src_len + 1))) == NULL)
+        char *txt;
+        if ((txt = arena_alloc(p_lex->p_arena, (size_t) (p_lex->src_len + 1))) == NULL)
                 goto read_err;
-        fread(src_txt, 1, (size_t) src_len, src_file);
+        fread(txt, 1, (size_t) p_lex->src_len, src_file);
         if (ferror(src_file))
                 goto read_err;
+        txt[p_lex->src_len] = '\0';
+        p_lex->src_txt = txt;
 
         goto read_success;
 
 read_err:
-        free(src_txt);
         perror("Failed to read source file");
         if (fclose(src_file) != 0)
                 PERREXIT("Failed to close source file");
-        
+        exit(EXIT_FAILURE);
+
 read_success:
-        if (fclose(src_file) != 0) {
-                free(src_txt);
+        if (fclose(src_file) != 0)
                 PERREXIT("Failed to close source file");
-        }
-        src_txt[src_len] = '\0';
         // debug
-        printf("Source file size: %ld\n", src_len);
+        printf("Source file size: %ld\n", p_lex->src_len);
         // debug end
 
-        init_keywords_map();
+        init_keywords_map(p_lex);
+}
+
+void lex_init(const char *file_name, struct Arena *p_arena)
+{
+        lexer_init(&default_lexer, file_name, p_arena);
+}
+
+void lex_free(void)
+{
+        lexer_free(&default_lexer);
+}
+
+enum TkType lex_next(struct Tk *p_tk)
+{
+        return lexer_next(&default_lexer, p_tk);
 }
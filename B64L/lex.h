@@ -1,4 +1,9 @@
+#include "hashmap.h"
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <setjmp.h>
 
 enum TkType {
         // assignment operators
@@ -104,20 +109,129 @@ enum TkTypeGroup
         G_MISC
 };
 
+union TkValue {
+        const char *txt;       // Used by 'LIT_STR' & 'IDENTIFIER', *not* NUL-terminated, see 'len'
+        int64_t int_v;         // Used by 'LIT_INT'
+        double fp_v;           // Used by 'LIT_FP'
+        char c;                // Used by 'LIT_CHAR'
+};
+
+// 'value' & 'len' are only set for the types that use them
 struct Tk {
         // Add 'type_group' type_str for debugging?
-        union {
-                char *txt;  // Used by 'LIT_STR' & 'IDENTIFIER'
-                int64_t int_v;         // Used by 'LIT_INT'
-                double fp_v;           // Used by 'LIT_FP'
-                char c;                // Used by 'LIT_CHAR'
-        } value;
+        union TkValue value;
         const char *type_str;
+        long len;       // of 'txt', which points into the source unless a string literal had escapes
         long line;      // ftell is archaic and returns a 'long', thus 'len' *also* has to be a 'long'
         long column;
         enum TkTypeGroup type_group;
         enum TkType type;
 };
 
-void lex_init(const char* file_name);
+struct Arena;
+
+/*
+  All of the state for lexing one file, nothing is shared between lexers
+  so separate files can be lexed on separate threads at once
+  (errors still exit the whole process)
+*/
+struct Lexer {
+        const char *src_txt;
+        char *src_buf;          // the mapping or streaming window behind 'src_txt', NULL if it isn't owned
+        long src_len;
+        long src_i;
+        long src_line;
+        long src_column;
+        size_t src_map_len;     // 0 unless 'src_buf' is mapped
+        FILE *src_stream;       // NULL unless streaming, 'src_txt' is then a window of the source
+        long src_cap;           // of the window
+        long src_last_nl;       // of the window, -1 if it has none
+        bool src_eof;           // nothing more to read into the window
+        struct Arena *p_arena;  // unmapped source & escaped string literals, tokens point into it
+        struct HashMap keywords_hashmap;
+        bool warned_tab_width;  // once per file, not per tab
+        jmp_buf *p_err_jmp;     // NULL unless speculative, errors then longjmp there instead of exiting
+};
+
+// Unmapped source text & escaped string literals are allocated from 'p_arena', so it has to outlive the tokens
+// 'file_name' "-" is stdin, it & pipes are streamed
+void lexer_init(struct Lexer *p_lex, const char *file_name, struct Arena *p_arena);
+// Lexes 'src_file' as it's read, only the line being lexed is held, token text is copied into 'p_arena'
+// 'lexer_free' closes 'src_file' unless it's stdin
+void lexer_init_stream(struct Lexer *p_lex, FILE *src_file, struct Arena *p_arena);
+void lexer_free(struct Lexer *p_lex); // unmaps the source, tokens can't be used after
+enum TkType lexer_next(struct Lexer *p_lex, struct Tk *p_tk);
+
+#define TK_PAYLOAD_DECODED 0x80000000u
+
+/*
+  A whole file's tokens as parallel arrays, for random access lookahead & backtracking
+  at 9 bytes a token, the last one is always 'END'
+  The arrays have a gap that 'lex_relex' leaves at the last edit: tokens [0, gap) are before it,
+  the rest are at the end of the arrays with 'offsets' back from 'src_len', so read them by index
+  with 'tk_stream_type', 'tk_stream_offset' & 'tk_stream_get'
+  'payloads' by type:
+  - 'LIT_INT' & 'LIT_NUM': index into 'values'
+  - 'LIT_CHAR': the char
+  - 'IDENTIFIER' & 'LIT_STR': length of the slice at 'offsets' (after the '"' for strings),
+    or 'TK_PAYLOAD_DECODED' | index into 'values' of the text, its length is the value after
+  - anything else: 0
+*/
+struct TkStream {
+        uint8_t *types;         // 'enum TkType'
+        uint32_t *offsets;      // into the source, where the token starts
+        uint32_t *payloads;
+        size_t len;
+        size_t cap;             // of all 3, they're one allocation so growing copies it once
+        size_t gap;             // 'cap - len' free slots start here
+        union TkValue *values;  // allocated on its own
+        size_t values_len;
+        size_t values_cap;
+        size_t values_dead;     // of replaced tokens
+        const char *src_txt;
+        long src_len;
+        long src_start;         // where lexing began
+};
+
+// 'removed_len' bytes at 'offset' of the old source were replaced by 'inserted_len' bytes
+struct TkEdit {
+        long offset;
+        long removed_len;
+        long inserted_len;
+};
+
+// Tokens [first, old_end) of the old stream are now [first, new_end)
+struct TkRange {
+        long first;
+        long old_end;
+        long new_end;
+};
+
+// The rest of the source into a new stream, the arrays are malloc'd & decoded text is in the lexer's arena
+// Needs the whole source, so not a streamed one, of 2 GB at most
+void lex_all(struct Lexer *p_lex, struct TkStream *p_stream);
+// 'line' & 'column' aren't kept, they're 0, see 'tk_stream_pos'
+// 'lex_all' split across up to 'n_threads' threads on line boundaries, same tokens & errors
+// Tab width isn't warned about for what's lexed on other threads, needs '-pthread'
+void lex_all_parallel(struct Lexer *p_lex, struct TkStream *p_stream, int n_threads);
+/*
+  Updates a stream from 'lex_all' for an edit, only relexing from just before it until the tokens
+  line up with the old ones again, those after aren't touched as they're past the gap
+  Moving the gap from the last edit costs the tokens in between, so nearby edits are cheap
+  'new_src' is the whole edited source, NUL-terminated, it replaces the lexer's & has to outlive the stream
+  Values of replaced tokens are dropped once they're half of them, their decoded text stays in
+  the arena until it's reset
+  'p_range' gets which tokens were replaced, on an error the stream is left as it was
+*/
+void lex_relex(struct Lexer *p_lex, struct TkStream *p_stream, const char *new_src, long new_src_len,
+               const struct TkEdit *p_edit, struct TkRange *p_range);
+enum TkType tk_stream_type(const struct TkStream *p_stream, long i);
+long tk_stream_offset(const struct TkStream *p_stream, long i); // into the source, where the token starts
+void tk_stream_get(const struct TkStream *p_stream, long i, struct Tk *p_tk);
+void tk_stream_pos(const struct TkStream *p_stream, long i, long *p_line, long *p_column); // O(offset)
+void tk_stream_free(struct TkStream *p_stream);
+
+// Same as the 'lexer_' functions on one lexer internal to 'lex.c', for a single file at a time
+void lex_init(const char* file_name, struct Arena *p_arena);
+void lex_free(void);
 enum TkType lex_next(struct Tk *p_tk); // Returns '1' if token type is *not* 'END'
@@ -8,6 +8,7 @@
 #include "bytecode_gen.h"
 // #include "VM.h"
 #include "util.h"
+#include "../arena8/arena8.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -15,6 +16,16 @@
 #define OUTPUT_BYTECODE_FILE "-c"
 #define RUN_NO_BYTECODE_FILE "-n"
 
+/*
+  One arena per phase, each is freed wholesale once the next phase is done with it,
+  so at most two phases worth of memory is live at once
+  - src: source text, identifiers & string literals, until codegen has consumed the tokens
+  - code: emitted bytecode, until it's been run or written
+  (no AST or IR phase yet, the parser emits bytecode straight from tokens)
+*/
+#define SRC_ARENA_BLOCK_SIZE (64 * 1024)
+#define CODE_ARENA_BLOCK_SIZE (16 * 1024)
+
 // barebones for testing purposes
 int main(int argc, const char *argv[])
 {
@@ -27,24 +38,31 @@ int main(int argc, const char *argv[])
                         " or one bytecode file to execute.");
 
         const char *file_name = argv[argc - 1];
+        struct Arena src_arena, code_arena;
+        arena_init(&src_arena, SRC_ARENA_BLOCK_SIZE);
+        arena_init(&code_arena, CODE_ARENA_BLOCK_SIZE);
         // assume 'option -n'
         if (argc == 2) {
-                lex_init(file_name);
-                bytecode_gen_nofile();
+                lex_init(file_name, &src_arena);
+                bytecode_gen_nofile(&code_arena);
         }
         else if (argc == 3) {
                 const char *flag = argv[1];
                 if (strcmp(flag, OUTPUT_BYTECODE_FILE)) {
-                        lex_init(file_name);
-                        // bytes = bytecode_gen_file();
+                        lex_init(file_name, &src_arena);
+                        // bytes = bytecode_gen_file(&code_arena);
                 }
                 else if (strcmp(flag, RUN_NO_BYTECODE_FILE)) {
-                        lex_init(file_name);
-                        // vm_run(bytecode_gen_nofile());
+                        lex_init(file_name, &src_arena);
+                        // vm_run(bytecode_gen_nofile(&code_arena));
                 }
                 else
                         ERREXIT("Invalid flag '%s'\n", flag);
         }
+        // tokens are all consumed by codegen
+        lex_free();
+        arena_clear(&src_arena);
+        arena_clear(&code_arena);
 
         return EXIT_SUCCESS;
 }
@@ -8,6 +8,7 @@ n  - Don't lex integer or number using '-' symbol, treat '-' as an operator (una
   - Fix
 */
 
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS & madvise
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -16,6 +17,11 @@ n  - Don't lex integer or number using '-' symbol, treat '-' as an operator (una
 #include <errno.h>
 #include <stdbool.h>
 #include "hashmap.h"
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // Gonna put these parameterized macros into header files
 // 'ERREXIT' & 'PERREXIT' expect *string literals* as the first argument format
@@ -144,7 +150,7 @@ static long src_line = 0;
 static long src_column = 0;
 static long src_i = 0;
 static long src_len;
-static char *src_txt;
+static char *src_txt; // read-only if mapped
 
 static const char* keywords[] = {
         "bool", "char", "int", "num",
@@ -642,8 +648,48 @@ static void gen_bytecode_file(void)
 }
 
 // should probably rework this to buffer instead of copying into a file
+#ifdef __linux__
+/*
+  Same as B64L's lexer, maps the file read-only with the zeroed rest of the last page
+  (or an anonymous page reserved under it) as the '\0' sentinel
+  Returns false if it can't be mapped, it's then read the normal way
+*/
+static bool map_src_file(FILE *src_file)
+{
+        int fd = fileno(src_file);
+        struct stat src_stat;
+        if (fstat(fd, &src_stat) != 0 || !S_ISREG(src_stat.st_mode))
+                return false;
+        size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+        size_t file_len = (size_t) src_stat.st_size;
+        size_t file_map_len = (file_len + page_size - 1) & ~(page_size - 1);
+        size_t map_len = (file_len + 1 + page_size - 1) & ~(page_size - 1);
+        char *map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+                return false;
+        if (file_map_len != 0 &&
+            mmap(map, file_map_len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+                munmap(map, map_len);
+                return false;
+        }
+        madvise(map, map_len, MADV_SEQUENTIAL);
+        src_txt = map;
+        src_len = (long) file_len;
+        return true;
+}
+#else
+static bool map_src_file(FILE *src_file)
+{
+        (void) src_file;
+        return false;
+}
+#endif
+
 static void init_src_file(FILE *src_file)
 {
+        if (map_src_file(src_file))
+                goto read_success;
+
         // fseek & ftell for portability to windows too ig???
         if (fseek(src_file, 0, SEEK_END) != 0)
                 goto read_err;
@@ -661,6 +707,7 @@ static void init_src_file(FILE *src_file)
         fread(src_txt, 1, (size_t) src_len, src_file);
         if (ferror(src_file))
                 goto read_err;
+        src_txt[src_len] = '\0';
 
         goto read_success;
 
@@ -674,12 +721,8 @@ read_err:
         exit(EXIT_FAILURE);
         
 read_success:
-        if (fclose(src_file) != 0) {
-                free(src_txt);
+        if (fclose(src_file) != 0)
                 PERREXIT("Failed to close source file");
-        }
-
-        src_txt[src_len] = '\0';
 
         // debug
         printf("Source file size: %ld\n", src_len);
@@ -229,6 +229,7 @@ void ___debug_instr(struct Instr *instr)
 struct Instr *parse_src(char src[], int *instrs_len)
 {
 	struct Instr *parsed_instrs = NULL;
+	int instrs_cap = 0;
 	srcp_cur = srcp_start = src; // only using a pointer to a local variable during it's lifetime, i think it's fine
 	*instrs_len = 0;
 
@@ -289,16 +290,20 @@ struct Instr *parse_src(char src[], int *instrs_len)
 
 		(*instrs_len)++;
 
-		// better than trying to manually free and malloc again
-		struct Instr *parsed_instrs_resize = realloc(parsed_instrs,
-		  (size_t) *instrs_len * sizeof(struct Instr));
+		// double the capacity, realloc'ing on every instruction made parsing O(n^2)
+		if (*instrs_len > instrs_cap) {
+			instrs_cap = instrs_cap == 0 ? 16 : instrs_cap * 2;
+			// better than trying to manually free and malloc again
+			struct Instr *parsed_instrs_resize = realloc(parsed_instrs,
+			  (size_t) instrs_cap * sizeof(struct Instr));
 
-		if (parsed_instrs_resize == NULL) {
-			free(parsed_instrs);
-			ERREXIT("Failed to alloc memory for instructions\n");
-		}
+			if (parsed_instrs_resize == NULL) {
+				free(parsed_instrs);
+				ERREXIT("Failed to alloc memory for instructions\n");
+			}
 
-		parsed_instrs = parsed_instrs_resize;
+			parsed_instrs = parsed_instrs_resize;
+		}
 		parsed_instrs[*instrs_len - 1] = instr;
 		end_statement();
 	}
@@ -1,85 +1,97 @@
 /* Arena Alloc C90 */
-#include "arena.h"
+#include "arena0.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
-struct Block {
-    struct Block *prev_block;
-    void *mem;
-};
-
-/* is pow of 2 */
-#define IS_ALIGNED_2(value) (((value) & ((value) - 1)) == 0)
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define ARENA_PAGE_SIZE 4096
+
 #define arena_add_block(p_arena, mem_size) \
     do { \
         struct Block *p_block = malloc(sizeof(struct Block)); \
-        p_block->mem = malloc(mem_size); \
+        ARENA_STAT(p_arena->stats.bytes_wasted += p_arena->current_block_size - p_arena->current_block_used; \
+                   p_arena->stats.retired_used += p_arena->current_block_used; \
+                   p_arena->stats.block_count++); \
+        p_block->mem = malloc((size_t) (mem_size)); \
         p_block->prev_block = p_arena->current_block; \
         p_arena->current_block = p_block; \
         p_arena->current_block_used = 0; \
         p_arena->current_block_size = mem_size; \
     } while (0)
 
+/* size of the next block, for a request of 'amount' bytes that didn't fit the current one */
+static ptrdiff_t arena_next_block_size(const struct Arena *p_arena, ptrdiff_t amount) {
+    ptrdiff_t block_size;
+    switch (p_arena->growth) {
+    case ARENA_GROWTH_DOUBLE:
+        block_size = p_arena->current_block_size * 2;
+        break;
+    case ARENA_GROWTH_PAGE:
+        block_size = (amount + (ARENA_PAGE_SIZE - 1)) & ~(ptrdiff_t) (ARENA_PAGE_SIZE - 1);
+        block_size = MAX(block_size, p_arena->default_block_size);
+        break;
+    case ARENA_GROWTH_FIXED:
+    default:
+        block_size = p_arena->default_block_size;
+    }
+    block_size = MAX(block_size, p_arena->min_block_size);
+    block_size = MIN(block_size, p_arena->max_block_size);
+    /* an oversized request always fits */
+    return MAX(block_size, amount);
+}
+
 void arena_init(struct Arena *p_arena, ptrdiff_t default_block_size) {
     assert(default_block_size > 0);
     p_arena->default_block_size = default_block_size;
+    p_arena->min_block_size = 0;
+    p_arena->max_block_size = PTRDIFF_MAX;
+    p_arena->growth = ARENA_GROWTH_FIXED;
     p_arena->current_block_used = 0;
     p_arena->current_block_size = default_block_size;
     /* C guarantees malloc returns a ptr with strictest alignment, I think */
     p_arena->current_block = malloc(sizeof(struct Block));
     p_arena->current_block->prev_block = NULL;
-    p_arena->current_block->mem = malloc(default_block_size);
+    p_arena->current_block->mem = malloc((size_t) default_block_size);
+    memset(&p_arena->stats, 0, sizeof p_arena->stats);
+    ARENA_STAT(p_arena->stats.block_count = 1);
 }
 
-/* Required memory alignment otherwise undefined behavior from misaligned access */
-/* 'align' is a pow of 2 */
-void *arena_align_alloc(struct Arena *p_arena, ptrdiff_t amount, ptrdiff_t align) {
-    assert(amount > 0 && align >= 0);
-    assert(IS_ALIGNED_2(align));
-    // assert(((size_t) (amount) & ((size_t) (align) - 1)) == 0); /* is amount aligned itself */
-
-    /* Blocks may not fully be used up */
-    if (amount > p_arena->current_block_size) {
-        arena_add_block(p_arena, amount);
-        p_arena->top_ptr = p_arena->current_block->mem;
-    }
-    else {
-        /* Implementation-defined behavior if uintptr_t can't be represened by ptrdiff_t, i think */
-        uintptr_t offset = (uintptr_t) p_arena->current_block->mem + p_arena->current_block_used;
-        p_arena->top_ptr = (char*) p_arena->current_block->mem + p_arena->current_block_used;
-        ptrdiff_t padding = -offset & (align - 1);
-        if (p_arena->current_block_used + (amount + padding) > p_arena->current_block_size) {
-            arena_add_block(p_arena, p_arena->default_block_size);
-            p_arena->top_ptr = p_arena->current_block->mem;
-        }
-        else {
-            amount += padding;
-            p_arena->top_ptr += padding;
-        }
-    }
+void arena_set_growth(struct Arena *p_arena, enum ArenaGrowth growth, ptrdiff_t min_block_size, ptrdiff_t max_block_size) {
+    assert(min_block_size >= 0 && min_block_size <= max_block_size);
+    p_arena->growth = growth;
+    p_arena->min_block_size = min_block_size;
+    p_arena->max_block_size = max_block_size;
+}
 
-    p_arena->current_block_used += amount;
-    /* printf("%llu\n", p_arena->current_block_used); */
-    return (void*) p_arena->top_ptr;
+/* the request didn't fit what's left of the current block, alignment is free at the start of a block */
+void *arena_align_alloc_slow(struct Arena *p_arena, ptrdiff_t amount) {
+    arena_add_block(p_arena, arena_next_block_size(p_arena, amount));
+    p_arena->top_ptr = p_arena->current_block->mem;
+    p_arena->current_block_used = amount;
+    ARENA_STAT_HIGH_WATER(p_arena);
+    return p_arena->top_ptr;
 }
 
 void *arena_realloc(struct Arena *p_arena, void *ptr, ptrdiff_t old_amount, ptrdiff_t new_amount) {
     ptrdiff_t offset;
     if (new_amount <= old_amount) return ptr;
+    ARENA_STAT(p_arena->stats.bytes_requested += new_amount - old_amount);
     offset = (char*) ptr - (char*) p_arena->current_block->mem;
     /* unable to know next ptr, so yeah */
     if (p_arena->top_ptr != ptr || offset + new_amount > p_arena->current_block_size) {
         /* Accept the block won't be fully used up */
-        arena_add_block(p_arena, MAX(new_amount, p_arena->default_block_size));
+        arena_add_block(p_arena, arena_next_block_size(p_arena, new_amount));
         p_arena->current_block_used = new_amount;
-        p_arena->top_ptr = memcpy(p_arena->current_block->mem, ptr, old_amount);
+        p_arena->top_ptr = memcpy(p_arena->current_block->mem, ptr, (size_t) old_amount);
+        ARENA_STAT(p_arena->stats.realloc_copies++);
     }
     else
         /* Grow in same block, as it's at top and doesnt exceed current block size */
         p_arena->current_block_used += new_amount - old_amount;
+    ARENA_STAT_HIGH_WATER(p_arena);
     return p_arena->top_ptr;
 }
 
@@ -91,14 +103,16 @@ void *arena_realloc_top(struct Arena *p_arena, ptrdiff_t new_amount) {
     offset = (char*) p_arena->top_ptr - (char*) p_arena->current_block->mem;
     old_amount = p_arena->current_block_used - offset;
     if (new_amount <= old_amount) return p_arena->top_ptr;
+    ARENA_STAT(p_arena->stats.bytes_requested += new_amount - old_amount);
     if (offset + new_amount > p_arena->current_block_size) {
-        void *old_ptr = p_arena->current_block->mem;
-        arena_add_block(p_arena, MAX(new_amount, p_arena->default_block_size));
+        arena_add_block(p_arena, arena_next_block_size(p_arena, new_amount));
         p_arena->current_block_used = new_amount;
-        p_arena->top_ptr = memcpy(p_arena->current_block->mem, p_arena->top_ptr, old_amount);
+        p_arena->top_ptr = memcpy(p_arena->current_block->mem, p_arena->top_ptr, (size_t) old_amount);
+        ARENA_STAT(p_arena->stats.realloc_copies++);
     } else
         /* Grow in same block */
         p_arena->current_block_used += new_amount - old_amount;
+    ARENA_STAT_HIGH_WATER(p_arena);
     return p_arena->top_ptr;
 }
 
@@ -116,6 +130,25 @@ void arena_reset(struct Arena *p_arena) {
     p_arena->current_block_size = p_arena->default_block_size;
     p_arena->current_block_used = 0;
     p_arena->top_ptr = NULL;
+    ARENA_STAT(p_arena->stats.retired_used = 0);
+}
+
+void arena_report(const struct Arena *p_arena, const char *name, FILE *stream) {
+#ifdef ARENA_STATS
+    const struct ArenaStats *p_stats = &p_arena->stats;
+    fprintf(stream, "Arena '%s':\n", name);
+    fprintf(stream, "  requested:      %ld bytes\n", (long) p_stats->bytes_requested);
+    fprintf(stream, "  padding:        %ld bytes\n", (long) p_stats->bytes_padding);
+    fprintf(stream, "  wasted tails:   %ld bytes\n", (long) p_stats->bytes_wasted);
+    fprintf(stream, "  blocks:         %ld\n", (long) p_stats->block_count);
+    fprintf(stream, "  high water:     %ld bytes\n", (long) p_stats->high_water);
+    fprintf(stream, "  realloc copies: %ld\n", (long) p_stats->realloc_copies);
+    fprintf(stream, "  block size:     %ld bytes (default %ld)\n",
+            (long) p_arena->current_block_size, (long) p_arena->default_block_size);
+#else
+    (void) p_arena;
+    fprintf(stream, "Arena '%s': compiled without ARENA_STATS\n", name);
+#endif
 }
 
 void arena_clear(struct Arena *p_arena) {
@@ -1,17 +1,76 @@
 #ifndef ARENA_H
 #define ARENA_H
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <assert.h>
 #define ARENA_ALIGNOF(data_type) offsetof(struct {char _; data_type placeholder;}, placeholder)
 
+#ifdef ARENA_STATS
+#define ARENA_STAT(stmt) do { stmt; } while (0)
+#else
+#define ARENA_STAT(stmt) ((void) 0)
+#endif
+#define ARENA_STAT_HIGH_WATER(p_arena) \
+    ARENA_STAT(if ((p_arena)->stats.retired_used + (p_arena)->current_block_used > (p_arena)->stats.high_water) \
+                   (p_arena)->stats.high_water = (p_arena)->stats.retired_used + (p_arena)->current_block_used)
+
+/* 'inline' is C99, plain 'static' still lets a C90 compiler inline it, but warns where it's unused */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L
+#define ARENA_INLINE static inline
+#elif defined(__GNUC__)
+#define ARENA_INLINE static __attribute__((unused))
+#else
+#define ARENA_INLINE static
+#endif
+#ifdef __GNUC__
+#define ARENA_COLD __attribute__((cold, noinline))
+#define ARENA_UNLIKELY(cond) __builtin_expect(!!(cond), 0)
+#else
+#define ARENA_COLD
+#define ARENA_UNLIKELY(cond) (cond)
+#endif
+
+/* how the size of a new block is picked once an allocation doesn't fit */
+enum ArenaGrowth {
+    ARENA_GROWTH_FIXED,  /* 'default_block_size', or the request if that is bigger */
+    ARENA_GROWTH_DOUBLE, /* double the last block, up to 'max_block_size' */
+    ARENA_GROWTH_PAGE    /* the request rounded up to a page, at least 'default_block_size' */
+};
+
+/* only counted when compiled with ARENA_STATS, the fields are always there so the layout doesn't change */
+struct ArenaStats {
+    ptrdiff_t bytes_requested; /* sum of the amounts asked for, realloc growth included */
+    ptrdiff_t bytes_padding;   /* lost to alignment padding */
+    ptrdiff_t bytes_wasted;    /* unused block tails left behind when a new block was added */
+    ptrdiff_t block_count;     /* blocks allocated, including the first */
+    ptrdiff_t high_water;      /* most bytes in use at once */
+    ptrdiff_t realloc_copies;  /* reallocs that had to memcpy into a new spot */
+    ptrdiff_t retired_used;    /* bytes used in blocks before the current one, for 'high_water' */
+};
+
+/* in the header only so the 'arena_align_alloc' fast path can be inlined */
+struct Block {
+    struct Block *prev_block;
+    void *mem;
+};
+
 struct Arena {
     void *top_ptr;
     struct Block *current_block;
     ptrdiff_t current_block_size;
     ptrdiff_t current_block_used;
     ptrdiff_t default_block_size;
+    ptrdiff_t min_block_size;
+    ptrdiff_t max_block_size; /* requests bigger than this still get a block of their own size */
+    enum ArenaGrowth growth;
+    struct ArenaStats stats;
 };
 
-struct Arena *arena_new(ptrdiff_t init_size);
-void *arena_align_alloc(struct Arena *p_arena, ptrdiff_t amount, ptrdiff_t align);
+void arena_init(struct Arena *p_arena, ptrdiff_t default_block_size);
+/* only affects blocks added after the call, defaults to 'ARENA_GROWTH_FIXED' with no min or max */
+void arena_set_growth(struct Arena *p_arena, enum ArenaGrowth growth, ptrdiff_t min_block_size, ptrdiff_t max_block_size);
+void *arena_align_alloc_slow(struct Arena *p_arena, ptrdiff_t amount) ARENA_COLD; /* new block */
 /* all caps just to signify it's a macro and not an 'inline' function */
 #define ARENA_TYPE_ALLOC(p_arena, element_type) arena_align_alloc(p_arena, sizeof(element_type), ARENA_ALIGNOF(element_type));
 /* !!! realloc assumes same align */
@@ -19,6 +78,28 @@ void *arena_realloc(struct Arena *p_arena, void *ptr, ptrdiff_t old_amount, ptrd
 void *arena_realloc_top(struct Arena *p_arena, ptrdiff_t new_amount);
 void arena_clear(struct Arena *p_arena); /* clear all blocks, effectively making arena unusable */
 void arena_reset(struct Arena *p_arena); /* clear until first block */
+void arena_report(const struct Arena *p_arena, const char *name, FILE *stream);
+
+/* Required memory alignment otherwise undefined behavior from misaligned access */
+/* 'align' is a pow of 2, the common case is a compare & bump at the call site */
+ARENA_INLINE void *arena_align_alloc(struct Arena *p_arena, ptrdiff_t amount, ptrdiff_t align) {
+    char *top;
+    ptrdiff_t padding;
+    assert(amount > 0 && align >= 0);
+    assert((align & (align - 1)) == 0);
+    ARENA_STAT(p_arena->stats.bytes_requested += amount);
+    top = (char*) p_arena->current_block->mem + p_arena->current_block_used;
+    /* Implementation-defined behavior if uintptr_t can't be represened by ptrdiff_t, i think */
+    padding = (ptrdiff_t) (-(uintptr_t) top & (uintptr_t) (align - 1));
+    /* Blocks may not fully be used up */
+    if (ARENA_UNLIKELY(amount + padding > p_arena->current_block_size - p_arena->current_block_used))
+        return arena_align_alloc_slow(p_arena, amount);
+    ARENA_STAT(p_arena->stats.bytes_padding += padding);
+    p_arena->top_ptr = top + padding;
+    p_arena->current_block_used += amount + padding;
+    ARENA_STAT_HIGH_WATER(p_arena);
+    return p_arena->top_ptr;
+}
 
 #undef DEFAULT_ALIGNMENT
 #endif
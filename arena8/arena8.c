@@ -1,111 +1,519 @@
 /*
  * NOTES: bc of a default alignment of 8, fuction pointers *may*
- * not be supported since they may have a an alignment of 16
+ * not be supported since they may have a an alignment of 16,
+ * 'arena_alloc_aligned' is for those (and SIMD / cache line / page aligned data)
  */
-#include "arena.h"
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS & MAP_NORESERVE
+#include "arena8.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
-
-struct Block {
-    struct Block *prev_block;
-    // ensure this is aligned to 8 bytes
-    char mem[];
-};
+#include <inttypes.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
-// (v + (align - 1)) & ~(align - 1), align forwards
-#define ALIGN8(unsigned_value) (((unsigned_value) + 7) & ~7)
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define ALIGN8(unsigned_value) ARENA_ALIGN8(unsigned_value)
+#define ALIGN_POW2(unsigned_value, align) (((unsigned_value) + ((align) - 1)) & ~((align) - 1))
+#define ARENA_PAGE_SIZE ((size_t) 4096)
+#define ARENA_HUGE_PAGE_SIZE ((size_t) 2 << 20)
+#define ARENA_MAX_ALIGN 4096
+
+static inline void arena_stats_init(struct Arena *restrict p_arena) {
+    memset(&p_arena->stats, 0, sizeof p_arena->stats);
+    ARENA_STAT(p_arena->stats.block_count = 1);
+}
+
+static inline void arena_idle_trim_init(struct Arena *restrict p_arena) {
+    p_arena->idle_trim = false;
+    p_arena->idle_trim_min = 0;
+    p_arena->recent_used = 0;
+    p_arena->resident_used = SIZE_MAX;
+}
+
+// Capacity of the next block, for a request of 'amount' bytes that didn't fit the current one
+static size_t arena_next_block_capacity(const struct Arena *restrict p_arena, size_t amount) {
+    size_t block_capacity;
+    switch (p_arena->growth) {
+    case ARENA_GROWTH_DOUBLE:
+        block_capacity = p_arena->current_block_capacity * 2;
+        break;
+    case ARENA_GROWTH_PAGE:
+        // page is counted with the header, so the whole malloc is page sized
+        block_capacity = ALIGN_POW2(sizeof(struct Block) + amount, ARENA_PAGE_SIZE) - sizeof(struct Block);
+        block_capacity = MAX(block_capacity, p_arena->default_block_capacity);
+        break;
+    case ARENA_GROWTH_FIXED:
+    default:
+        block_capacity = p_arena->default_block_capacity;
+    }
+    block_capacity = MAX(block_capacity, p_arena->min_block_capacity);
+    block_capacity = MIN(block_capacity, p_arena->max_block_capacity);
+    // an oversized request always fits
+    return ALIGN8(MAX(block_capacity, amount));
+}
+
+#ifdef __linux__
+// 2 MB aligned mapping advised for THP, NULL if mmap failed
+static struct Block *arena_huge_block_new(size_t map_size) {
+    // over-map by a huge page, then trim both ends to get the alignment
+    char *map = mmap(NULL, map_size + ARENA_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    char *aligned = (char*) ALIGN_POW2((uintptr_t) map, ARENA_HUGE_PAGE_SIZE);
+    if (aligned != map)
+        munmap(map, (size_t) (aligned - map));
+    munmap(aligned + map_size, ARENA_HUGE_PAGE_SIZE - (size_t) (aligned - map));
+#ifdef MADV_HUGEPAGE
+    // fails if THP is disabled, the mapping is then just backed by normal pages
+    madvise(aligned, map_size, MADV_HUGEPAGE);
+#endif
+    return (struct Block*) aligned;
+}
+#endif
+
+// 'p_block_capacity' may be rounded up to use all of a huge page mapping
+static struct Block *arena_block_new(const struct Arena *restrict p_arena, size_t *p_block_capacity) {
+#ifdef __linux__
+    size_t size = sizeof(struct Block) + *p_block_capacity;
+    if (p_arena->huge_pages && size >= ARENA_HUGE_PAGE_SIZE) {
+        size_t map_size = ALIGN_POW2(size, ARENA_HUGE_PAGE_SIZE);
+        struct Block *p_block = arena_huge_block_new(map_size);
+        if (p_block != NULL) {
+            p_block->map_size = map_size;
+            *p_block_capacity = map_size - sizeof(struct Block);
+            return p_block;
+        }
+    }
+#else
+    (void) p_arena;
+#endif
+    struct Block *p_block = malloc(sizeof(struct Block) + *p_block_capacity);
+    p_block->map_size = 0;
+    return p_block;
+}
+
+static void arena_block_free(struct Block *p_block) {
+#ifdef __linux__
+    if (p_block->map_size != 0) {
+        munmap(p_block, p_block->map_size);
+        return;
+    }
+#endif
+    free(p_block);
+}
 
 static inline void arena_add_block(struct Arena *restrict p_arena, size_t block_capacity) {
-    struct Block *p_block = malloc(sizeof(struct Block) + block_capacity);
+    ARENA_STAT(p_arena->stats.bytes_wasted += p_arena->current_block_capacity - p_arena->current_block_used;
+               p_arena->stats.retired_used += p_arena->current_block_used;
+               p_arena->stats.block_count++);
+    p_arena->current_block->capacity = p_arena->current_block_capacity;
+    p_arena->current_block->used = p_arena->current_block_used;
+    struct Block *p_block = arena_block_new(p_arena, &block_capacity);
     p_block->prev_block = p_arena->current_block;
     p_arena->current_block = p_block;
     p_arena->current_block_used = 0;
     p_arena->current_block_capacity = block_capacity;
 }
 
+#ifdef __linux__
+// Commit pages of the reservation until 'needed' bytes of the block are usable, never moves the block
+static bool arena_commit(struct Arena *restrict p_arena, size_t needed) {
+    if (needed > p_arena->reserve_capacity) return false;
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t committed = sizeof(struct Block) + p_arena->current_block_capacity;
+    // at least double what's committed, so a growing top allocation costs a logarithmic amount of mprotects
+    size_t commit_end = MAX(ALIGN_POW2(sizeof(struct Block) + needed, page_size), committed * 2);
+    commit_end = MIN(commit_end, sizeof(struct Block) + p_arena->reserve_capacity);
+    if (mprotect((char*) p_arena->current_block + committed, commit_end - committed, PROT_READ | PROT_WRITE) != 0)
+        return false;
+    p_arena->current_block_capacity = commit_end - sizeof(struct Block);
+    return true;
+}
+#else
+static bool arena_commit(struct Arena *restrict p_arena, size_t needed) {
+    (void) p_arena, (void) needed;
+    return false;
+}
+#endif
+
+#ifdef __linux__
+// Whole pages of 'p_block' from 'keep_bytes' to 'capacity' as a page aligned range, false if there are none
+static bool arena_block_tail(const struct Block *p_block, size_t capacity, size_t keep_bytes,
+                             uintptr_t *p_start, uintptr_t *p_end) {
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    if (keep_bytes >= capacity)
+        return false;
+    // rounded inwards, malloc's own headers are on the pages around a malloc'd block
+    *p_start = ALIGN_POW2((uintptr_t) (p_block->mem + keep_bytes), page_size);
+    *p_end = (uintptr_t) (p_block->mem + capacity) & ~(uintptr_t) (page_size - 1);
+    return *p_start < *p_end;
+}
+
+// Whole pages of the current block past 'keep_bytes' (or what's used) are dropped, false if there were none
+static bool arena_trim_block(struct Arena *restrict p_arena, size_t keep_bytes) {
+    uintptr_t start, end;
+    if (!arena_block_tail(p_arena->current_block, p_arena->current_block_capacity,
+                          MAX(keep_bytes, p_arena->current_block_used), &start, &end))
+        return false;
+    // private anonymous pages read back as zero once touched again, which the arena never promised anyway
+    madvise((void*) start, end - start, MADV_DONTNEED);
+    if (p_arena->reserve_capacity != 0) {
+        // the committed end is page aligned, so this is the whole tail and 'arena_commit' can bring it back
+        mprotect((void*) start, end - start, PROT_NONE);
+        p_arena->current_block_capacity = (size_t) ((char*) start - p_arena->current_block->mem);
+    }
+    return true;
+}
+
+// A retired block's tail past what it uses, unmapped if it was mmap'd so 'map_size' shrinks with it
+static void arena_trim_retired(struct Block *p_block) {
+    uintptr_t start, end;
+    if (!arena_block_tail(p_block, p_block->capacity, p_block->used, &start, &end))
+        return;
+    if (p_block->map_size != 0 && end == (uintptr_t) p_block + p_block->map_size) {
+        munmap((void*) start, end - start);
+        p_block->map_size = (size_t) (start - (uintptr_t) p_block);
+        p_block->capacity = p_block->map_size - sizeof(struct Block);
+    }
+    else
+        madvise((void*) start, end - start, MADV_DONTNEED);
+}
+#else
+static bool arena_trim_block(struct Arena *restrict p_arena, size_t keep_bytes) {
+    (void) p_arena, (void) keep_bytes;
+    return false;
+}
+
+static void arena_trim_retired(struct Block *p_block) {
+    (void) p_block;
+}
+#endif
+
 void arena_init(struct Arena *restrict p_arena, size_t default_block_capacity) {
     assert(default_block_capacity > 0);
     default_block_capacity = ALIGN8(default_block_capacity);
     p_arena->default_block_capacity = default_block_capacity;
     p_arena->current_block_used = 0;
     p_arena->current_block_capacity = default_block_capacity;
+    p_arena->reserve_capacity = 0;
+    p_arena->min_block_capacity = 0;
+    p_arena->max_block_capacity = SIZE_MAX;
+    p_arena->growth = ARENA_GROWTH_FIXED;
+    p_arena->huge_pages = false;
     /* C guarantees malloc returns a ptr with strictest alignment, I think */
-    p_arena->current_block = malloc(sizeof(struct Block) + default_block_capacity);
+    p_arena->current_block = arena_block_new(p_arena, &default_block_capacity);
     p_arena->current_block->prev_block = NULL;
     p_arena->top_ptr = NULL;
+    arena_stats_init(p_arena);
+    arena_idle_trim_init(p_arena);
 }
 
-// Required memory alignment otherwise undefined behavior from misaligned access
-void *arena_alloc(struct Arena *restrict p_arena, size_t amount) {
-    assert(amount > 0);
-    amount = ALIGN8(amount); // just align size, so pointers themselves are already aligned
+// Every block is at least a huge page, so they all go through 'arena_huge_block_new'
+void arena_init_huge(struct Arena *restrict p_arena, size_t default_block_capacity) {
+    assert(default_block_capacity > 0);
+    size_t min_block_capacity = ARENA_HUGE_PAGE_SIZE - sizeof(struct Block);
+    default_block_capacity = MAX(ALIGN8(default_block_capacity), min_block_capacity);
+    p_arena->huge_pages = true;
+    p_arena->default_block_capacity = default_block_capacity;
+    p_arena->current_block_used = 0;
+    p_arena->reserve_capacity = 0;
+    p_arena->min_block_capacity = min_block_capacity;
+    p_arena->max_block_capacity = SIZE_MAX;
+    p_arena->growth = ARENA_GROWTH_FIXED;
+    p_arena->current_block = arena_block_new(p_arena, &default_block_capacity);
+    p_arena->current_block->prev_block = NULL;
+    p_arena->current_block_capacity = default_block_capacity;
+    p_arena->top_ptr = NULL;
+    arena_stats_init(p_arena);
+    arena_idle_trim_init(p_arena);
+}
+
+// The whole reservation is a single block, so 'top_ptr' is only ever bumped forwards
+bool arena_init_vm(struct Arena *restrict p_arena, size_t reserve_capacity) {
+    assert(reserve_capacity > 0);
+#ifdef __linux__
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    size_t map_size = ALIGN_POW2(sizeof(struct Block) + reserve_capacity, page_size);
+    // PROT_NONE & MAP_NORESERVE, only address space is taken until pages are committed
+    void *map = mmap(NULL, map_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (map == MAP_FAILED)
+        return false;
+    if (mprotect(map, page_size, PROT_READ | PROT_WRITE) != 0) {
+        munmap(map, map_size);
+        return false;
+    }
+    p_arena->current_block = map;
+    p_arena->current_block->prev_block = NULL;
+    p_arena->current_block->map_size = 0;
+    p_arena->huge_pages = false;
+    p_arena->reserve_capacity = map_size - sizeof(struct Block);
+    p_arena->current_block_capacity = page_size - sizeof(struct Block);
+    p_arena->default_block_capacity = p_arena->current_block_capacity;
+    // unused, growth is done by committing more of the reservation
+    p_arena->min_block_capacity = 0;
+    p_arena->max_block_capacity = SIZE_MAX;
+    p_arena->growth = ARENA_GROWTH_FIXED;
+    p_arena->current_block_used = 0;
+    p_arena->top_ptr = NULL;
+    arena_stats_init(p_arena);
+    arena_idle_trim_init(p_arena);
+    return true;
+#else
+    (void) p_arena;
+    return false;
+#endif
+}
+
+void arena_trim(struct Arena *restrict p_arena, size_t keep_bytes) {
+    arena_trim_block(p_arena, keep_bytes);
+    p_arena->resident_used = MAX(keep_bytes, p_arena->current_block_used);
+    // the first block stays, 'arena_reset' goes back to it
+    struct Block **pp_block = &p_arena->current_block->prev_block;
+    while (*pp_block != NULL) {
+        struct Block *p_block = *pp_block;
+        if (p_block->used == 0 && p_block->prev_block != NULL) {
+            *pp_block = p_block->prev_block;
+            arena_block_free(p_block);
+            continue;
+        }
+        arena_trim_retired(p_block);
+        pp_block = &p_block->prev_block;
+    }
+}
+
+void arena_set_idle_trim(struct Arena *restrict p_arena, bool enabled, size_t min_keep_bytes) {
+    p_arena->idle_trim = enabled;
+    p_arena->idle_trim_min = min_keep_bytes;
+    p_arena->recent_used = 0;
+    p_arena->resident_used = SIZE_MAX;
+}
+
+void arena_set_growth(struct Arena *restrict p_arena, enum ArenaGrowth growth,
+                      size_t min_block_capacity, size_t max_block_capacity) {
+    assert(min_block_capacity <= max_block_capacity);
+    p_arena->growth = growth;
+    p_arena->min_block_capacity = min_block_capacity;
+    p_arena->max_block_capacity = max_block_capacity;
+}
+
+// Only reached once the bump in 'arena_alloc' didn't fit, 'amount' is already aligned & counted
+void *arena_alloc_slow(struct Arena *restrict p_arena, size_t amount) {
     // Blocks may not fully be used up
-    if (p_arena->current_block_used + amount > p_arena->current_block_capacity) {
-        arena_add_block(p_arena, amount);
+    if (p_arena->reserve_capacity != 0) {
+        // out of reserved address space
+        if (!arena_commit(p_arena, p_arena->current_block_used + amount))
+            return NULL;
+        p_arena->top_ptr = p_arena->current_block->mem + p_arena->current_block_used;
+    }
+    else {
+        arena_add_block(p_arena, arena_next_block_capacity(p_arena, amount));
         p_arena->top_ptr = p_arena->current_block->mem;
     }
-    else
-        p_arena->top_ptr = p_arena->current_block->mem + p_arena->current_block_used;
     p_arena->current_block_used += amount;
+    ARENA_STAT(arena_stats_high_water(p_arena));
+    return p_arena->top_ptr;
+}
+
+// Padding is counted as used, so it stays behind 'top_ptr' and 'arena_realloc_top' still works
+void *arena_alloc_aligned(struct Arena *restrict p_arena, size_t amount, size_t align) {
+    assert(amount > 0);
+    assert(align > 0 && align <= ARENA_MAX_ALIGN && (align & (align - 1)) == 0);
+    if (align <= 8)
+        return arena_alloc(p_arena, amount);
+    ARENA_STAT(p_arena->stats.bytes_requested += amount;
+               p_arena->stats.bytes_padding += ALIGN8(amount) - amount);
+    amount = ALIGN8(amount);
+    size_t padding = -(uintptr_t) (p_arena->current_block->mem + p_arena->current_block_used) & (align - 1);
+    if (p_arena->current_block_used + padding + amount > p_arena->current_block_capacity) {
+        if (p_arena->reserve_capacity != 0) {
+            // committing doesn't move the block, so the padding stays the same
+            if (!arena_commit(p_arena, p_arena->current_block_used + padding + amount))
+                return NULL;
+        }
+        else {
+            // 'mem' is at least 8 aligned, so that's the most padding a new block can need
+            arena_add_block(p_arena, arena_next_block_capacity(p_arena, amount + align - 8));
+            padding = -(uintptr_t) p_arena->current_block->mem & (align - 1);
+        }
+    }
+    ARENA_STAT(p_arena->stats.bytes_padding += padding);
+    p_arena->top_ptr = p_arena->current_block->mem + p_arena->current_block_used + padding;
+    p_arena->current_block_used += padding + amount;
+    ARENA_STAT(arena_stats_high_water(p_arena));
     return p_arena->top_ptr;
 }
 
 void *arena_realloc(struct Arena *p_arena, void *ptr, size_t old_amount, size_t new_amount) {
+    return arena_realloc_aligned(p_arena, ptr, old_amount, new_amount, 8);
+}
+
+void *arena_realloc_aligned(struct Arena *p_arena, void *ptr, size_t old_amount, size_t new_amount, size_t align) {
     if (new_amount <= old_amount) return ptr;
-    size_t offset = (char*) ptr - (char*) p_arena->current_block->mem;
-    // Accept the block won't be fully used up
-    // Unable to know next ptr if ptr isn't at top, so yeah
-    if (p_arena->top_ptr != ptr || offset + new_amount > p_arena->current_block_capacity) {
-        arena_add_block(p_arena, MAX(new_amount, p_arena->default_block_capacity));
-        p_arena->current_block_used = new_amount;
-        p_arena->top_ptr = memcpy(p_arena->current_block->mem, ptr, old_amount);
-    }
-    else
+    old_amount = ALIGN8(old_amount);
+    new_amount = ALIGN8(new_amount);
+    size_t offset = (size_t) ((char*) ptr - (char*) p_arena->current_block->mem);
+    if (p_arena->top_ptr == ptr) {
         // Grow in same block, as it's at top
-        p_arena->current_block_used += new_amount - old_amount;
-    return p_arena->top_ptr;
+        if (offset + new_amount <= p_arena->current_block_capacity ||
+            (p_arena->reserve_capacity != 0 && arena_commit(p_arena, offset + new_amount))) {
+            ARENA_STAT(p_arena->stats.bytes_requested += new_amount - old_amount);
+            p_arena->current_block_used = offset + new_amount;
+            ARENA_STAT(arena_stats_high_water(p_arena));
+            return ptr;
+        }
+        // Out of reserved address space
+        if (p_arena->reserve_capacity != 0)
+            return NULL;
+    }
+    // Unable to know next ptr if ptr isn't at top, so copy it to the top instead
+    // Accept the old copy won't be reused
+    void *new_ptr = arena_alloc_aligned(p_arena, new_amount, align);
+    if (new_ptr == NULL)
+        return NULL;
+    ARENA_STAT(p_arena->stats.realloc_copies++);
+    return memcpy(new_ptr, ptr, old_amount);
 }
 
 // No ptr param, as it's known at top
 void *arena_realloc_top(struct Arena *restrict p_arena, size_t new_amount) {
     assert(new_amount > 0);
     assert(p_arena->top_ptr != NULL);
-    size_t offset = (char*) p_arena->top_ptr - (char*) p_arena->current_block->mem;
+    new_amount = ALIGN8(new_amount);
+    size_t offset = (size_t) ((char*) p_arena->top_ptr - (char*) p_arena->current_block->mem);
     size_t old_amount = p_arena->current_block_used - offset;
-    if (new_amount <= old_amount) return p_arena->top_ptr;
+    // Shrinking gives the tail back to the block
+    if (new_amount <= old_amount) {
+        p_arena->current_block_used -= old_amount - new_amount;
+        return p_arena->top_ptr;
+    }
+    ARENA_STAT(p_arena->stats.bytes_requested += new_amount - old_amount);
     if (offset + new_amount > p_arena->current_block_capacity) {
-        arena_add_block(p_arena, MAX(new_amount, p_arena->default_block_capacity));
+        // Reserved arenas commit more pages instead, so the top is never copied
+        if (p_arena->reserve_capacity != 0) {
+            if (!arena_commit(p_arena, offset + new_amount))
+                return NULL;
+            p_arena->current_block_used = offset + new_amount;
+            ARENA_STAT(arena_stats_high_water(p_arena));
+            return p_arena->top_ptr;
+        }
+        // the old copy is dead once it's moved, so 'arena_trim' can drop it with the rest of the tail
+        p_arena->current_block_used = offset;
+        arena_add_block(p_arena, arena_next_block_capacity(p_arena, new_amount));
         p_arena->current_block_used = new_amount;
         p_arena->top_ptr = memcpy(p_arena->current_block->mem, p_arena->top_ptr, old_amount);
+        ARENA_STAT(p_arena->stats.realloc_copies++);
     } else
         // Grow in same block
         p_arena->current_block_used += new_amount - old_amount;
+    ARENA_STAT(arena_stats_high_water(p_arena));
     return p_arena->top_ptr;
 }
 
+// Halving average, so one big job stops holding memory after a few small ones
+static void arena_idle_trim(struct Arena *restrict p_arena, size_t first_block_used) {
+    p_arena->recent_used = p_arena->recent_used / 2 + first_block_used / 2;
+    p_arena->resident_used = MAX(p_arena->resident_used, first_block_used);
+    size_t keep_bytes = MAX(p_arena->recent_used, p_arena->idle_trim_min);
+    // only syscalls if pages past what's kept may have been touched since the last trim
+    if (p_arena->resident_used > keep_bytes) {
+        arena_trim_block(p_arena, keep_bytes);
+        p_arena->resident_used = keep_bytes;
+    }
+}
+
 void arena_reset(struct Arena *restrict p_arena) {
     struct Block *p_block = p_arena->current_block;
     struct Block *p_prev_block = p_block->prev_block;
+    // the first block was filled if there are more after it
+    size_t first_block_used = p_prev_block != NULL ? SIZE_MAX : p_arena->current_block_used;
     while (p_prev_block != NULL) {
-        free(p_block);
+        arena_block_free(p_block);
         p_block = p_prev_block;
         p_prev_block = p_block->prev_block;
     }
     p_arena->current_block = p_block;
-    p_arena->current_block_capacity = p_arena->default_block_capacity;
+    // Reserved arenas keep what they've committed
+    if (p_block->map_size != 0)
+        p_arena->current_block_capacity = p_block->map_size - sizeof(struct Block);
+    else if (p_arena->reserve_capacity == 0)
+        p_arena->current_block_capacity = p_arena->default_block_capacity;
     p_arena->current_block_used = 0;
     p_arena->top_ptr = NULL;
+    ARENA_STAT(p_arena->stats.retired_used = 0);
+    if (p_arena->idle_trim)
+        arena_idle_trim(p_arena, MIN(first_block_used, p_arena->current_block_capacity));
 }
 
 void arena_clear(const struct Arena *restrict p_arena) {
+#ifdef __linux__
+    if (p_arena->reserve_capacity != 0) {
+        munmap(p_arena->current_block, sizeof(struct Block) + p_arena->reserve_capacity);
+        return;
+    }
+#endif
     struct Block *p_block = p_arena->current_block;
     struct Block *p_prev_block;
     while (p_block != NULL) {
         p_prev_block = p_block->prev_block;
-        free(p_block);
+        arena_block_free(p_block);
         p_block = p_prev_block;
     }
 }
+
+void arena_report(const struct Arena *restrict p_arena, const char *name, FILE *stream) {
+#ifdef ARENA_STATS
+    const struct ArenaStats *p_stats = &p_arena->stats;
+    fprintf(stream, "Arena '%s':\n", name);
+    fprintf(stream, "  requested:      %zu bytes\n", p_stats->bytes_requested);
+    fprintf(stream, "  padding:        %zu bytes\n", p_stats->bytes_padding);
+    fprintf(stream, "  wasted tails:   %zu bytes\n", p_stats->bytes_wasted);
+    fprintf(stream, "  blocks:         %zu\n", p_stats->block_count);
+    fprintf(stream, "  high water:     %zu bytes\n", p_stats->high_water);
+    fprintf(stream, "  realloc copies: %zu\n", p_stats->realloc_copies);
+    fprintf(stream, "  block capacity: %zu bytes (default %zu)\n",
+            p_arena->current_block_capacity, p_arena->default_block_capacity);
+#else
+    (void) p_arena;
+    fprintf(stream, "Arena '%s': compiled without ARENA_STATS\n", name);
+#endif
+}
+
+// Sums 'AnonHugePages' of the mappings in /proc/self/smaps that hold the arena's mmap'd blocks
+// Adjacent mappings with the same flags get merged by the kernel, so this may count a neighbour too
+size_t arena_huge_pages(const struct Arena *restrict p_arena) {
+#ifdef __linux__
+    FILE *smaps = fopen("/proc/self/smaps", "r");
+    if (smaps == NULL)
+        return 0;
+    char line[256];
+    bool in_arena = false;
+    size_t huge_kb = 0;
+    while (fgets(line, sizeof line, smaps) != NULL) {
+        uintptr_t start, end;
+        size_t kb;
+        // mapping header lines are the only ones starting with 'start-end'
+        if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR " ", &start, &end) == 2) {
+            in_arena = false;
+            for (const struct Block *p_block = p_arena->current_block; p_block != NULL; p_block = p_block->prev_block)
+                if (p_block->map_size != 0 && (uintptr_t) p_block < end &&
+                    (uintptr_t) p_block + p_block->map_size > start) {
+                    in_arena = true;
+                    break;
+                }
+        }
+        else if (in_arena && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1)
+            huge_kb += kb;
+    }
+    fclose(smaps);
+    return huge_kb / (ARENA_HUGE_PAGE_SIZE >> 10);
+#else
+    (void) p_arena;
+    return 0;
+#endif
+}
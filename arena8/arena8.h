@@ -2,6 +2,55 @@
 #define ARENA_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <assert.h>
+
+// (v + (align - 1)) & ~(align - 1), align forwards
+#define ARENA_ALIGN8(unsigned_value) (((unsigned_value) + 7) & ~(size_t) 7)
+
+#ifdef ARENA_STATS
+#define ARENA_STAT(stmt) do { stmt; } while (0)
+#else
+#define ARENA_STAT(stmt) ((void) 0)
+#endif
+
+#ifdef __GNUC__
+#define ARENA_COLD __attribute__((cold, noinline))
+#define ARENA_UNLIKELY(cond) __builtin_expect(!!(cond), 0)
+#else
+#define ARENA_COLD
+#define ARENA_UNLIKELY(cond) (cond)
+#endif
+
+// How the capacity of a new block is picked once an allocation doesn't fit
+enum ArenaGrowth {
+    ARENA_GROWTH_FIXED,  // 'default_block_capacity', or the request if that is bigger
+    ARENA_GROWTH_DOUBLE, // double the last block, up to 'max_block_capacity'
+    ARENA_GROWTH_PAGE    // the request rounded up to a page, at least 'default_block_capacity'
+};
+
+// Only counted when compiled with ARENA_STATS, the fields are always there so the layout doesn't change
+struct ArenaStats {
+    size_t bytes_requested; // sum of the amounts asked for, realloc growth included
+    size_t bytes_padding;   // lost to rounding amounts up to 8
+    size_t bytes_wasted;    // unused block tails left behind when a new block was added
+    size_t block_count;     // blocks allocated, including the first
+    size_t high_water;      // most bytes in use at once
+    size_t realloc_copies;  // reallocs that had to memcpy into a new spot
+    size_t retired_used;    // bytes used in blocks before the current one, for 'high_water'
+};
+
+// In the header only so the 'arena_alloc' fast path can be inlined
+struct Block {
+    struct Block *prev_block;
+    size_t map_size; // 0 unless the block was mmap'd for huge pages
+    size_t capacity; // only set once a newer block is added, the arena tracks the current one
+    size_t used;
+    // ensure this is aligned to 8 bytes
+    char mem[];
+};
 
 struct Arena {
     void *top_ptr;
@@ -9,12 +58,63 @@ struct Arena {
     size_t current_block_capacity;
     size_t current_block_used;
     size_t default_block_capacity;
+    size_t min_block_capacity;
+    size_t max_block_capacity; // requests bigger than this still get a block of their own size
+    enum ArenaGrowth growth;
+    bool huge_pages; // set by 'arena_init_huge'
+    struct ArenaStats stats;
+    size_t reserve_capacity; // 0 unless reserved by 'arena_init_vm', current block capacity is then the committed bytes
+    bool idle_trim; // set by 'arena_set_idle_trim'
+    size_t idle_trim_min;
+    size_t recent_used;   // decaying average of the first block's use per reset cycle
+    size_t resident_used; // first block bytes that may still be backed by memory since the last trim
 };
 
 void arena_init(struct Arena *restrict p_arena, size_t default_block_capacity);
-void *arena_alloc(struct Arena *restrict p_arena, size_t amount);
+// One contiguous reservation, pages are committed on demand so it never chains blocks or copies on growth
+// Returns false if the reservation failed or the platform doesn't support it
+bool arena_init_vm(struct Arena *restrict p_arena, size_t reserve_capacity);
+// Blocks are at least 2 MB, 2 MB aligned & mmap'd with MADV_HUGEPAGE, normal pages if THP is unavailable
+void arena_init_huge(struct Arena *restrict p_arena, size_t default_block_capacity);
+size_t arena_huge_pages(const struct Arena *restrict p_arena); // huge pages backing the arena right now
+// Only affects blocks added after the call, defaults to 'ARENA_GROWTH_FIXED' with no min or max
+void arena_set_growth(struct Arena *restrict p_arena, enum ArenaGrowth growth,
+                      size_t min_block_capacity, size_t max_block_capacity);
+// Gives the current block's unused pages past 'keep_bytes' back to the OS, decommits them if reserved
+// Older blocks are never allocated from again, so they keep only what they use & empty ones are freed
+void arena_trim(struct Arena *restrict p_arena, size_t keep_bytes);
+// When enabled, 'arena_reset' trims to the recent use of the arena (at least 'min_keep_bytes'), not its peak
+void arena_set_idle_trim(struct Arena *restrict p_arena, bool enabled, size_t min_keep_bytes);
+void *arena_alloc_slow(struct Arena *restrict p_arena, size_t amount) ARENA_COLD; // new block or commit
+// 'align' is a pow of 2 up to 4096, 8 or less is just 'arena_alloc'
+void *arena_alloc_aligned(struct Arena *restrict p_arena, size_t amount, size_t align);
 void *arena_realloc(struct Arena *restrict p_arena, void *ptr, size_t old_amount, size_t new_amount);
-void *arena_realloc_top(struct Arena *restrict p_arena, size_t new_amount); // grow in place
+// Same as 'arena_realloc', but a copy keeps 'align' instead of 8
+void *arena_realloc_aligned(struct Arena *restrict p_arena, void *ptr, size_t old_amount, size_t new_amount, size_t align);
+// Grow or shrink in place, if it has to move to a new block it is only 8 aligned, use 'arena_realloc_aligned' on 'top_ptr' instead
+void *arena_realloc_top(struct Arena *restrict p_arena, size_t new_amount);
 void arena_reset(struct Arena *restrict p_arena); // clear until first block
 void arena_clear(const struct Arena *restrict p_arena); // clear all blocks, effectively making arena unusable
+void arena_report(const struct Arena *restrict p_arena, const char *name, FILE *stream);
+
+static inline void arena_stats_high_water(struct Arena *restrict p_arena) {
+    size_t in_use = p_arena->stats.retired_used + p_arena->current_block_used;
+    if (in_use > p_arena->stats.high_water)
+        p_arena->stats.high_water = in_use;
+}
+
+// Required memory alignment otherwise undefined behavior from misaligned access
+// Inlined so the common case is a compare & bump at the call site, everything else is 'arena_alloc_slow'
+static inline void *arena_alloc(struct Arena *restrict p_arena, size_t amount) {
+    assert(amount > 0);
+    ARENA_STAT(p_arena->stats.bytes_requested += amount;
+               p_arena->stats.bytes_padding += ARENA_ALIGN8(amount) - amount);
+    amount = ARENA_ALIGN8(amount); // just align size, so pointers themselves are already aligned
+    if (ARENA_UNLIKELY(p_arena->current_block_used + amount > p_arena->current_block_capacity))
+        return arena_alloc_slow(p_arena, amount);
+    p_arena->top_ptr = p_arena->current_block->mem + p_arena->current_block_used;
+    p_arena->current_block_used += amount;
+    ARENA_STAT(arena_stats_high_water(p_arena));
+    return p_arena->top_ptr;
+}
 #endif
@@ -0,0 +1,58 @@
+/*
+ * NOTES: slots are never given back to the arena individually, a freed
+ * slot can only be reused by the same size class
+ */
+#include "pool.h"
+#include <stdlib.h>
+#include <assert.h>
+
+// 8 byte classes since arena8 only aligns to 8 anyway
+#define SIZE_CLASS(size) (((size) + 7) / 8 - 1)
+
+void pool_init(struct Pool *restrict p_pool, struct Arena *p_arena) {
+    p_pool->p_arena = p_arena;
+    for (int i = 0; i < POOL_SIZE_CLASSES; i++)
+        p_pool->free_lists[i] = NULL;
+}
+
+// Carve a slab of slots out of the arena & thread them onto the free list, false if the arena is out of memory
+static bool pool_refill(struct Pool *restrict p_pool, size_t size_class) {
+    size_t slot_size = (size_class + 1) * 8;
+    char *slab = arena_alloc(p_pool->p_arena, slot_size * POOL_SLAB_SLOTS);
+    if (slab == NULL)
+        return false;
+    struct PoolSlot *p_next_slot = p_pool->free_lists[size_class];
+    // thread backwards, so slots are handed out in address order
+    for (size_t i = POOL_SLAB_SLOTS; i-- > 0;) {
+        struct PoolSlot *p_slot = (struct PoolSlot*) (slab + i * slot_size);
+        p_slot->next_slot = p_next_slot;
+        p_next_slot = p_slot;
+    }
+    p_pool->free_lists[size_class] = p_next_slot;
+    return true;
+}
+
+void *pool_alloc(struct Pool *restrict p_pool, size_t size) {
+    assert(size > 0 && size <= POOL_MAX_SLOT_SIZE);
+    size_t size_class = SIZE_CLASS(size);
+    if (p_pool->free_lists[size_class] == NULL && !pool_refill(p_pool, size_class))
+        return NULL;
+    struct PoolSlot *p_slot = p_pool->free_lists[size_class];
+    p_pool->free_lists[size_class] = p_slot->next_slot;
+    return p_slot;
+}
+
+void pool_free(struct Pool *restrict p_pool, void *ptr, size_t size) {
+    assert(size > 0 && size <= POOL_MAX_SLOT_SIZE);
+    if (ptr == NULL) return;
+    size_t size_class = SIZE_CLASS(size);
+    struct PoolSlot *p_slot = ptr;
+    p_slot->next_slot = p_pool->free_lists[size_class];
+    p_pool->free_lists[size_class] = p_slot;
+}
+
+void pool_release_all(struct Pool *restrict p_pool) {
+    for (int i = 0; i < POOL_SIZE_CLASSES; i++)
+        p_pool->free_lists[i] = NULL;
+    arena_reset(p_pool->p_arena);
+}
@@ -0,0 +1,24 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "arena8.h"
+
+#define POOL_SIZE_CLASSES 32 // slot sizes of 8, 16, ... 256
+#define POOL_MAX_SLOT_SIZE (POOL_SIZE_CLASSES * 8)
+#define POOL_SLAB_SLOTS 64 // slots carved out of the arena per refill
+
+// Freed slots hold the free list link themselves, so live objects have no header
+struct PoolSlot {
+    struct PoolSlot *next_slot;
+};
+
+struct Pool {
+    struct Arena *p_arena; // should be owned by the pool, see 'pool_release_all'
+    struct PoolSlot *free_lists[POOL_SIZE_CLASSES];
+};
+
+void pool_init(struct Pool *restrict p_pool, struct Arena *p_arena);
+void *pool_alloc(struct Pool *restrict p_pool, size_t size); // 'size' up to 'POOL_MAX_SLOT_SIZE'
+void pool_free(struct Pool *restrict p_pool, void *ptr, size_t size); // same 'size' it was allocated with
+void pool_release_all(struct Pool *restrict p_pool); // frees every slot at once by resetting the arena
+#endif
@@ -0,0 +1,99 @@
+/*
+ * NOTES: 'used' is bumped past 'capacity' by every thread that finds a
+ * block full, it is only ever compared against 'capacity', never trusted
+ */
+#include "shared_arena.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+struct SharedBlock {
+    struct SharedBlock *prev_block;
+    size_t capacity;
+    size_t used; // only accessed atomically
+    // ensure this is aligned to 8 bytes
+    char mem[];
+};
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+// (v + (align - 1)) & ~(align - 1), align forwards
+#define ALIGN8(unsigned_value) (((unsigned_value) + 7) & ~(size_t) 7)
+
+static struct SharedBlock *shared_block_new(struct SharedBlock *p_prev_block, size_t capacity, size_t used) {
+    struct SharedBlock *p_block = malloc(sizeof(struct SharedBlock) + capacity);
+    if (p_block == NULL)
+        return NULL;
+    p_block->prev_block = p_prev_block;
+    p_block->capacity = capacity;
+    p_block->used = used;
+    return p_block;
+}
+
+void shared_arena_init(struct SharedArena *p_arena, size_t default_block_capacity) {
+    assert(default_block_capacity > 0);
+    p_arena->default_block_capacity = ALIGN8(default_block_capacity);
+    p_arena->current_block = shared_block_new(NULL, p_arena->default_block_capacity, 0);
+    p_arena->large_blocks = NULL;
+}
+
+// A request over half a block would mostly retire the shared block early, so it gets its own
+static void *shared_arena_alloc_large(struct SharedArena *p_arena, size_t amount) {
+    struct SharedBlock *p_block = shared_block_new(NULL, amount, amount);
+    if (p_block == NULL)
+        return NULL;
+    p_block->prev_block = __atomic_load_n(&p_arena->large_blocks, __ATOMIC_RELAXED);
+    // 'prev_block' is refreshed with the current head on every failed attempt
+    while (!__atomic_compare_exchange_n(&p_arena->large_blocks, &p_block->prev_block, p_block,
+                                        true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return p_block->mem;
+}
+
+void *shared_arena_alloc(struct SharedArena *p_arena, size_t amount) {
+    assert(amount > 0);
+    amount = ALIGN8(amount);
+    if (amount > p_arena->default_block_capacity / 2)
+        return shared_arena_alloc_large(p_arena, amount);
+    struct SharedBlock *p_block = __atomic_load_n(&p_arena->current_block, __ATOMIC_ACQUIRE);
+    while (true) {
+        size_t offset = __atomic_fetch_add(&p_block->used, amount, __ATOMIC_RELAXED);
+        if (offset + amount <= p_block->capacity)
+            return p_block->mem + offset;
+        // Block is full, race to install the next one, which starts with this allocation already in it
+        struct SharedBlock *p_next_block = shared_block_new(p_block, p_arena->default_block_capacity, amount);
+        if (p_next_block == NULL)
+            return NULL;
+        if (__atomic_compare_exchange_n(&p_arena->current_block, &p_block, p_next_block,
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            return p_next_block->mem;
+        // Lost the race, 'p_block' now holds the winner's block so retry on that
+        free(p_next_block);
+    }
+}
+
+static void shared_blocks_free(struct SharedBlock *p_block) {
+    struct SharedBlock *p_prev_block;
+    while (p_block != NULL) {
+        p_prev_block = p_block->prev_block;
+        free(p_block);
+        p_block = p_prev_block;
+    }
+}
+
+void shared_arena_reset(struct SharedArena *p_arena) {
+    struct SharedBlock *p_block = p_arena->current_block;
+    struct SharedBlock *p_prev_block = p_block->prev_block;
+    while (p_prev_block != NULL) {
+        free(p_block);
+        p_block = p_prev_block;
+        p_prev_block = p_block->prev_block;
+    }
+    p_block->used = 0;
+    p_arena->current_block = p_block;
+    shared_blocks_free(p_arena->large_blocks);
+    p_arena->large_blocks = NULL;
+}
+
+void shared_arena_clear(struct SharedArena *p_arena) {
+    shared_blocks_free(p_arena->current_block);
+    shared_blocks_free(p_arena->large_blocks);
+}
@@ -0,0 +1,19 @@
+#ifndef SHARED_ARENA_H
+#define SHARED_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// One region many threads bump at once, lock-free with GCC/Clang '__atomic' builtins
+struct SharedArena {
+    struct SharedBlock *current_block; // only accessed atomically
+    struct SharedBlock *large_blocks;  // requests too big to share a block, only accessed atomically
+    size_t default_block_capacity;
+};
+
+void shared_arena_init(struct SharedArena *p_arena, size_t default_block_capacity);
+void *shared_arena_alloc(struct SharedArena *p_arena, size_t amount); // thread-safe, NULL if malloc failed
+// Not thread-safe, no 'shared_arena_alloc' may be in flight
+void shared_arena_reset(struct SharedArena *p_arena); // clear until first block
+void shared_arena_clear(struct SharedArena *p_arena); // clear all blocks, effectively making arena unusable
+#endif
@@ -0,0 +1,65 @@
+#include "strbuild.h"
+#include "vec.h"
+#include <stdio.h>
+#include <string.h>
+
+void strbuild_init(struct StrBuild *restrict p_sb, struct Arena *p_arena) {
+    p_sb->p_arena = p_arena;
+    p_sb->data = NULL;
+    p_sb->len = 0;
+    p_sb->cap = 0;
+}
+
+bool strbuild_reserve(struct StrBuild *restrict p_sb, size_t extra) {
+    if (p_sb->len + extra <= p_sb->cap)
+        return true;
+    return vec_grow(p_sb->p_arena, &p_sb->data, &p_sb->cap, p_sb->len + extra, 1);
+}
+
+bool strbuild_append(struct StrBuild *restrict p_sb, const char *str, size_t len) {
+    // 'data' may still be NULL, which memcpy doesn't allow even for 0 bytes
+    if (len == 0)
+        return true;
+    if (!strbuild_reserve(p_sb, len))
+        return false;
+    memcpy(p_sb->data + p_sb->len, str, len);
+    p_sb->len += len;
+    return true;
+}
+
+bool strbuild_append_int(struct StrBuild *restrict p_sb, int64_t value) {
+    char digits[20]; // INT64_MIN has 19 digits & a sign
+    size_t i = sizeof digits;
+    // negate as unsigned so INT64_MIN doesn't overflow
+    uint64_t magnitude = value < 0 ? -(uint64_t) value : (uint64_t) value;
+    do {
+        digits[--i] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0)
+        digits[--i] = '-';
+    return strbuild_append(p_sb, digits + i, sizeof digits - i);
+}
+
+bool strbuild_append_num(struct StrBuild *restrict p_sb, double value) {
+    int len = snprintf(NULL, 0, "%g", value);
+    // +1 since snprintf always writes the NUL, 'strbuild_finish' needs the room anyway
+    if (len < 0 || !strbuild_reserve(p_sb, (size_t) len + 1))
+        return false;
+    snprintf(p_sb->data + p_sb->len, (size_t) len + 1, "%g", value);
+    p_sb->len += (size_t) len;
+    return true;
+}
+
+char *strbuild_finish(struct StrBuild *restrict p_sb, size_t *p_len) {
+    if (!strbuild_push(p_sb, '\0'))
+        return NULL;
+    char *str = p_sb->data;
+    if (p_len != NULL)
+        *p_len = p_sb->len - 1;
+    // Something else was allocated after it otherwise, the tail is just lost until a reset
+    if (str == p_sb->p_arena->top_ptr)
+        arena_realloc_top(p_sb->p_arena, p_sb->len);
+    strbuild_init(p_sb, p_sb->p_arena);
+    return str;
+}
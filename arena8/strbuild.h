@@ -0,0 +1,29 @@
+#ifndef STRBUILD_H
+#define STRBUILD_H
+
+#include "arena8.h"
+
+// Grows in place while it's the top allocation, so nothing else should be allocated from the arena until it's finished
+struct StrBuild {
+    struct Arena *p_arena;
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+void strbuild_init(struct StrBuild *restrict p_sb, struct Arena *p_arena);
+bool strbuild_reserve(struct StrBuild *restrict p_sb, size_t extra); // false if the arena is out of memory
+bool strbuild_append(struct StrBuild *restrict p_sb, const char *str, size_t len);
+bool strbuild_append_int(struct StrBuild *restrict p_sb, int64_t value);
+bool strbuild_append_num(struct StrBuild *restrict p_sb, double value); // "%g"
+// NUL-terminates and gives the unused capacity back to the arena, the builder is empty again afterwards
+// 'p_len' may be NULL, returns NULL if the arena is out of memory
+char *strbuild_finish(struct StrBuild *restrict p_sb, size_t *p_len);
+
+static inline bool strbuild_push(struct StrBuild *restrict p_sb, char c) {
+    if (p_sb->len == p_sb->cap && !strbuild_reserve(p_sb, 1))
+        return false;
+    p_sb->data[p_sb->len++] = c;
+    return true;
+}
+#endif
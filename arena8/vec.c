@@ -0,0 +1,23 @@
+#include "vec.h"
+#include <string.h>
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+bool vec_grow(struct Arena *restrict p_arena, void *p_data, size_t *p_cap, size_t min_cap, size_t element_size) {
+    size_t new_cap = MAX(*p_cap * 2, MAX(min_cap, VEC_MIN_CAP));
+    // copied in & out, 'p_data' is really an 'element_type **'
+    void *data, *new_data;
+    memcpy(&data, p_data, sizeof data);
+    if (data == NULL)
+        new_data = arena_alloc(p_arena, new_cap * element_size);
+    // nothing was allocated after it, so the block can just be extended
+    else if (data == p_arena->top_ptr)
+        new_data = arena_realloc_top(p_arena, new_cap * element_size);
+    else
+        new_data = arena_realloc(p_arena, data, *p_cap * element_size, new_cap * element_size);
+    if (new_data == NULL)
+        return false;
+    memcpy(p_data, &new_data, sizeof new_data);
+    *p_cap = new_cap;
+    return true;
+}
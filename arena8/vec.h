@@ -0,0 +1,27 @@
+#ifndef VEC_H
+#define VEC_H
+
+#include "arena8.h"
+#include <assert.h>
+
+#define VEC_MIN_CAP 8
+
+// Anonymous vector struct, e.g. 'VEC(struct Tk) tks = {0};' or 'typedef VEC(int) IntVec;'
+#define VEC(element_type) struct { element_type *data; size_t len, cap; }
+
+// Grows '*p_data' to at least 'min_cap' elements, doubling so pushes are amortized O(1)
+// In place with 'arena_realloc_top' while it's the top allocation
+// 'p_data' points to the vector's element pointer, false if the arena is out of memory & then nothing is changed
+bool vec_grow(struct Arena *restrict p_arena, void *p_data, size_t *p_cap, size_t min_cap, size_t element_size);
+
+/* all caps just to signify they're macros, 'p_vec' is evaluated more than once */
+// Both are false if the arena is out of memory, the vector is then left as it was
+#define VEC_RESERVE(p_arena, p_vec, n) \
+    ((size_t) (n) <= (p_vec)->cap || \
+     vec_grow((p_arena), &(p_vec)->data, &(p_vec)->cap, (n), sizeof *(p_vec)->data))
+#define VEC_PUSH(p_arena, p_vec, value) \
+    (VEC_RESERVE((p_arena), (p_vec), (p_vec)->len + 1) && ((p_vec)->data[(p_vec)->len++] = (value), true))
+#define VEC_POP(p_vec) (assert((p_vec)->len > 0), (p_vec)->data[--(p_vec)->len])
+#define VEC_AT(p_vec, i) ((p_vec)->data[(assert((size_t) (i) < (p_vec)->len), (i))])
+#define VEC_DATA(p_vec) ((p_vec)->data)
+#endif
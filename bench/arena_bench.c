@@ -0,0 +1,343 @@
+/*
+ * Replays allocation traces typical of the toolchain against the system
+ * allocator & the arenas, and reports ns/op, peak RSS and fragmentation
+ *
+ * arena0 and arena8 export the same names, so one of them is picked per build,
+ * 'make' in this directory builds both:
+ *   ./bench_arena8 [block_size] [fixed|double|page]
+ *
+ * NOTES: every backend & workload runs in a forked child so the peak RSS is its own,
+ * except that it also counts the trace arrays the child shares with the parent,
+ * that part is the "baseline RSS" printed first
+ * fragmentation is what malloc has handed out at the workload's peak over the bytes
+ * the workload asked for, so the arenas' unused block tails & malloc's headers both count
+ */
+#define _DEFAULT_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#ifdef BENCH_ARENA0
+#include "arena0.h"
+// arena0 takes sizes as ptrdiff_t
+#define ARENA_SIZE(size) ((ptrdiff_t) (size))
+#else
+#include "arena8.h"
+#include "pool.h"
+#define ARENA_SIZE(size) (size)
+#endif
+
+#define TOKEN_COUNT 1000000  // small token & identifier allocations kept alive together
+#define GROW_ROUNDS 200      // top buffers grown from empty to 'GROW_MAX'
+#define GROW_STEP 64
+#define GROW_MAX (256 * 1024)
+#define CYCLE_COUNT 2000     // requests, the arena is reset after each one
+#define CYCLE_ALLOCS 2000    // allocations per request
+
+struct Backend {
+    const char *name;
+    void (*init)(void);
+    void *(*alloc)(size_t size);
+    void *(*grow)(void *ptr, size_t old_size, size_t new_size); // NULL if the backend can't grow a buffer
+    void (*release)(void **ptrs, const uint16_t *sizes, size_t count); // free everything from this cycle
+    void (*teardown)(void);
+};
+
+static size_t g_block_size = 64 * 1024;
+static int g_growth; // index into 'growth_names'
+static const char *growth_names[] = {"fixed", "double", "page"};
+
+/* --- glibc malloc --- */
+
+static void malloc_init(void) {}
+
+static void *malloc_alloc(size_t size) {
+    return malloc(size);
+}
+
+static void *malloc_grow(void *ptr, size_t old_size, size_t new_size) {
+    (void) old_size;
+    return realloc(ptr, new_size);
+}
+
+static void malloc_release(void **ptrs, const uint16_t *sizes, size_t count) {
+    (void) sizes;
+    for (size_t i = 0; i < count; i++)
+        free(ptrs[i]);
+}
+
+static void malloc_teardown(void) {}
+
+/* --- arenas, reset per cycle --- */
+
+static struct Arena g_arena;
+
+static void arena_bench_init(void) {
+    arena_init(&g_arena, ARENA_SIZE(g_block_size));
+    if (g_growth == 1)
+        arena_set_growth(&g_arena, ARENA_GROWTH_DOUBLE, 0, ARENA_SIZE(64 * g_block_size));
+    else if (g_growth == 2)
+        arena_set_growth(&g_arena, ARENA_GROWTH_PAGE, 0, ARENA_SIZE(64 * g_block_size));
+}
+
+static void *arena_bench_alloc(size_t size) {
+#ifdef BENCH_ARENA0
+    return arena_align_alloc(&g_arena, ARENA_SIZE(size), 8);
+#else
+    return arena_alloc(&g_arena, size);
+#endif
+}
+
+// Nothing else is allocated while a buffer grows, so it's always at the top
+static void *arena_bench_grow(void *ptr, size_t old_size, size_t new_size) {
+    (void) ptr; (void) old_size;
+    return arena_realloc_top(&g_arena, ARENA_SIZE(new_size));
+}
+
+static void arena_bench_release(void **ptrs, const uint16_t *sizes, size_t count) {
+    (void) ptrs; (void) sizes; (void) count;
+    arena_reset(&g_arena);
+}
+
+static void arena_bench_teardown(void) {
+    arena_clear(&g_arena);
+}
+
+#ifndef BENCH_ARENA0
+/* --- pool on top of arena8, frees slot by slot --- */
+
+static struct Pool g_pool;
+
+static void pool_bench_init(void) {
+    arena_bench_init();
+    pool_init(&g_pool, &g_arena);
+}
+
+static void *pool_bench_alloc(size_t size) {
+    return pool_alloc(&g_pool, size);
+}
+
+static void pool_bench_release(void **ptrs, const uint16_t *sizes, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        pool_free(&g_pool, ptrs[i], sizes[i]);
+}
+#endif
+
+static const struct Backend backends[] = {
+    {"malloc", malloc_init, malloc_alloc, malloc_grow, malloc_release, malloc_teardown},
+#ifdef BENCH_ARENA0
+    {"arena0", arena_bench_init, arena_bench_alloc, arena_bench_grow, arena_bench_release, arena_bench_teardown},
+#else
+    {"arena8", arena_bench_init, arena_bench_alloc, arena_bench_grow, arena_bench_release, arena_bench_teardown},
+    {"pool", pool_bench_init, pool_bench_alloc, NULL, pool_bench_release, arena_bench_teardown},
+#endif
+};
+
+/* --- traces --- */
+
+static uint64_t g_rng_state = 0x9e3779b97f4a7c15;
+
+static uint64_t xorshift64(void) {
+    g_rng_state ^= g_rng_state << 13;
+    g_rng_state ^= g_rng_state >> 7;
+    g_rng_state ^= g_rng_state << 17;
+    return g_rng_state;
+}
+
+// Mostly short identifiers & token structs, with the odd string literal
+static uint16_t token_size(void) {
+    uint64_t r = xorshift64();
+    if (r % 16 == 0)
+        return (uint16_t) (32 + r / 16 % 224); // string literal, up to 255
+    return (uint16_t) (4 + r / 16 % 44);       // token or identifier
+}
+
+// Generated up front so the RNG isn't part of the timing
+static uint16_t *g_token_sizes;
+static void **g_ptrs;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+// Bytes malloc has handed out, arena blocks included, -1 if unknown
+static long long malloc_in_use(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    // glibc's API returns the struct, nothing to be done about -Waggregate-return
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Waggregate-return"
+    struct mallinfo2 info = mallinfo2();
+#pragma GCC diagnostic pop
+    return (long long) (info.uordblks + info.hblkhd);
+#else
+    return -1;
+#endif
+}
+
+struct Result {
+    uint64_t ops;
+    uint64_t ns;
+    size_t peak_requested; // live bytes asked for at the peak
+    long long peak_in_use; // what malloc had handed out for them, -1 if unknown
+};
+
+static void run_tokens(const struct Backend *p_backend, struct Result *p_result) {
+    long long base = malloc_in_use();
+    size_t requested = 0;
+    uint64_t start = now_ns();
+    p_backend->init();
+    for (size_t i = 0; i < TOKEN_COUNT; i++) {
+        g_ptrs[i] = p_backend->alloc(g_token_sizes[i]);
+        *(char*) g_ptrs[i] = (char) i; // touch it, like the lexer would
+        requested += g_token_sizes[i];
+    }
+    long long in_use = malloc_in_use();
+    p_backend->release(g_ptrs, g_token_sizes, TOKEN_COUNT);
+    p_backend->teardown();
+    p_result->ns = now_ns() - start;
+    p_result->ops = TOKEN_COUNT;
+    p_result->peak_requested = requested;
+    p_result->peak_in_use = base < 0 ? -1 : in_use - base;
+}
+
+static void run_grow(const struct Backend *p_backend, struct Result *p_result) {
+    long long base = malloc_in_use();
+    long long in_use = 0;
+    uint64_t start = now_ns();
+    p_backend->init();
+    for (int round = 0; round < GROW_ROUNDS; round++) {
+        size_t size = GROW_STEP;
+        char *buf = p_backend->alloc(size);
+        for (; size < GROW_MAX; size += GROW_STEP) {
+            buf = p_backend->grow(buf, size, size + GROW_STEP);
+            buf[size] = (char) size;
+        }
+        if (round == 0)
+            in_use = malloc_in_use();
+        void *ptr = buf;
+        uint16_t dummy_size = 0;
+        p_backend->release(&ptr, &dummy_size, 1);
+    }
+    p_backend->teardown();
+    p_result->ns = now_ns() - start;
+    p_result->ops = (uint64_t) GROW_ROUNDS * (GROW_MAX / GROW_STEP);
+    p_result->peak_requested = GROW_MAX;
+    p_result->peak_in_use = base < 0 ? -1 : in_use - base;
+}
+
+static void run_cycles(const struct Backend *p_backend, struct Result *p_result) {
+    long long base = malloc_in_use();
+    long long in_use = 0;
+    size_t requested = 0;
+    uint64_t start = now_ns();
+    p_backend->init();
+    for (int cycle = 0; cycle < CYCLE_COUNT; cycle++) {
+        // each request replays a different slice of the token trace
+        const uint16_t *sizes = g_token_sizes + (size_t) cycle * CYCLE_ALLOCS % (TOKEN_COUNT - CYCLE_ALLOCS);
+        for (size_t i = 0; i < CYCLE_ALLOCS; i++) {
+            g_ptrs[i] = p_backend->alloc(sizes[i]);
+            *(char*) g_ptrs[i] = (char) i;
+        }
+        if (cycle == CYCLE_COUNT - 1) {
+            in_use = malloc_in_use();
+            for (size_t i = 0; i < CYCLE_ALLOCS; i++)
+                requested += sizes[i];
+        }
+        p_backend->release(g_ptrs, sizes, CYCLE_ALLOCS);
+    }
+    p_backend->teardown();
+    p_result->ns = now_ns() - start;
+    p_result->ops = (uint64_t) CYCLE_COUNT * CYCLE_ALLOCS;
+    p_result->peak_requested = requested;
+    p_result->peak_in_use = base < 0 ? -1 : in_use - base;
+}
+
+static const struct {
+    const char *name;
+    void (*run)(const struct Backend *p_backend, struct Result *p_result);
+    bool needs_grow;
+} workloads[] = {
+    {"tokens", run_tokens, false},
+    {"grow-top", run_grow, true},
+    {"reset-cycle", run_cycles, false},
+};
+
+// In a child, so RUSAGE_SELF is this backend & workload alone on top of the shared trace
+static void run_child(const struct Backend *p_backend, int workload) {
+    struct Result result;
+    workloads[workload].run(p_backend, &result);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("%-12s %-8s %10.2f %12ld", workloads[workload].name, p_backend->name,
+           (double) result.ns / (double) result.ops, usage.ru_maxrss);
+    if (result.peak_in_use < 0)
+        printf(" %9s\n", "-");
+    else
+        printf(" %8.1f%%\n", 100.0 * (1.0 - (double) result.peak_requested / (double) result.peak_in_use));
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1)
+        g_block_size = strtoull(argv[1], NULL, 0);
+    if (argc > 2) {
+        for (g_growth = 0; g_growth < 3 && strcmp(argv[2], growth_names[g_growth]) != 0; g_growth++);
+        if (g_growth == 3) {
+            fprintf(stderr, "usage: %s [block_size] [fixed|double|page]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (g_block_size == 0) {
+        fprintf(stderr, "block size has to be > 0\n");
+        return 1;
+    }
+
+    g_token_sizes = malloc(TOKEN_COUNT * sizeof *g_token_sizes);
+    g_ptrs = malloc(TOKEN_COUNT * sizeof *g_ptrs);
+    if (g_token_sizes == NULL || g_ptrs == NULL) {
+        fprintf(stderr, "out of memory for the trace\n");
+        return 1;
+    }
+    for (size_t i = 0; i < TOKEN_COUNT; i++)
+        g_token_sizes[i] = token_size();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    printf("block size %zu, %s growth, baseline RSS %ld KB\n", g_block_size, growth_names[g_growth], usage.ru_maxrss);
+    printf("%-12s %-8s %10s %12s %9s\n", "workload", "backend", "ns/op", "peak RSS KB", "frag");
+    fflush(stdout);
+
+    for (size_t w = 0; w < sizeof workloads / sizeof *workloads; w++) {
+        for (size_t b = 0; b < sizeof backends / sizeof *backends; b++) {
+            if (workloads[w].needs_grow && backends[b].grow == NULL)
+                continue;
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                return 1;
+            }
+            if (pid == 0) {
+                run_child(&backends[b], (int) w);
+                _exit(0);
+            }
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                fprintf(stderr, "%s/%s failed\n", workloads[w].name, backends[b].name);
+        }
+    }
+    free(g_token_sizes);
+    free(g_ptrs);
+    return 0;
+}